@@ -0,0 +1,90 @@
+#ifndef BUFFER_HPP
+#define BUFFER_HPP
+
+#include "common.hpp"
+
+// Recycles buffer storage in power-of-four size classes (4 KB up to 1 MB)
+// One pool per event loop; it is not thread-safe
+class BufferPool
+{
+	public:
+		// Constructor
+		BufferPool(void);
+
+		// Destructor
+		~BufferPool(void);
+
+		// Others
+		char	*get(std::size_t minSize, std::size_t &capacity);
+		void	put(char *data, std::size_t capacity);
+
+	private:
+		enum { CLASSES = 5 };
+		std::vector<char*> _free[CLASSES];
+
+		static int	classOf(std::size_t size);
+
+		BufferPool(const BufferPool &obj);
+		BufferPool &operator=(const BufferPool &obj);
+};
+
+// A range of bytes inside a Buffer; kept as an offset so it stays valid when
+// the buffer grows or compacts, as long as nothing before it is consumed
+struct Slice
+{
+	std::size_t	offset;
+	std::size_t	length;
+
+	Slice(void): offset(0), length(0) {}
+	Slice(std::size_t sliceOffset, std::size_t sliceLength): offset(sliceOffset), length(sliceLength) {}
+};
+
+// Growable byte buffer: data is appended at the tail (directly by read(2) through
+// writePtr/commit) and consumed from the head without moving the rest
+// Storage comes from a BufferPool when one is attached
+class Buffer
+{
+	public:
+		static const std::size_t npos = static_cast<std::size_t>(-1);
+
+		// Constructor
+		Buffer(void);
+		Buffer(const Buffer &obj);
+
+		// Destructor
+		~Buffer(void);
+
+		// Operators
+		Buffer &operator=(const Buffer &obj);
+
+		// Setters
+		void	setPool(BufferPool *pool);
+
+		// Getters
+		const char	*data(void) const;
+		std::size_t	size(void) const;
+		bool	empty(void) const;
+		std::size_t	capacity(void) const;
+		char	*writePtr(void);
+		std::size_t	writable(void) const;
+
+		// Others
+		void	reserve(std::size_t n);
+		void	commit(std::size_t n);
+		void	append(const char *bytes, std::size_t n);
+		void	consume(std::size_t n);
+		void	erase(std::size_t pos, std::size_t n);
+		void	clear(void);
+		void	release(void);
+		std::size_t	find(const char *needle, std::size_t pos = 0) const;
+		std::string	substr(std::size_t pos, std::size_t len = npos) const;
+
+	private:
+		char	*_data;
+		std::size_t	_capacity;
+		std::size_t	_start; // first unconsumed byte
+		std::size_t	_end; // one past the last byte
+		BufferPool	*_pool;
+};
+
+#endif
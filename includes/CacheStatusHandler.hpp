@@ -0,0 +1,31 @@
+#ifndef CACHESTATUSHANDLER_HPP
+#define CACHESTATUSHANDLER_HPP
+
+#include "common.hpp"
+#include "IRequestHandler.hpp"
+#include "Request.hpp"
+#include "Response.hpp"
+#include "ServerConfig.hpp"
+#include "StaticFileHandler.hpp"
+
+// Reports the virtual server's content_cache counters as plain text, for a
+// location with content_cache_status on (like NGINX's stub_status)
+// The counters are those of the worker that answers
+class CacheStatusHandler : public IRequestHandler
+{
+	public:
+		CacheStatusHandler(const ServerConfig &config, const FileCaches &caches);
+		virtual ~CacheStatusHandler(void);
+
+		virtual void handle(const Request &req, Response &res);
+
+	private:
+		const ServerConfig &_config;
+		FileCaches _caches;
+
+		CacheStatusHandler();
+		CacheStatusHandler(const CacheStatusHandler &obj);
+		CacheStatusHandler &operator=(const CacheStatusHandler &obj);
+};
+
+#endif
@@ -24,8 +24,7 @@ class CgiHandler : public IRequestHandler
 		std::string executeCgi(const Request &req, Response &res, const std::string &scriptPath) const;
 		char **createEnvArray(const std::map<std::string, std::string>& envMap) const;
 		void handleChildProcess(const Request &req, const std::string &scriptPath, char **env, int pipe_in[2], int pipe_out[2]) const;
-		bool writeRequestBody(const Request &req, int writeFd) const;
-		std::string readCgiOutput(int readFd) const;
+		bool exchangeWithCgi(const Request &req, int writeFd, int readFd, std::string &output) const;
 		void parseCgiResponse(const std::string &cgiOutput, Response &res) const;
 
 		CgiHandler();
@@ -0,0 +1,24 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include "common.hpp"
+#include "Request.hpp"
+#include "Response.hpp"
+#include "Route.hpp"
+
+// Content codings a response body can be compressed with (zlib)
+enum ContentCoding
+{
+	CODING_IDENTITY,
+	CODING_GZIP,
+	CODING_DEFLATE // the zlib format, as HTTP's "deflate"
+};
+
+bool	acceptsCoding(const std::string &acceptEncoding, const std::string &coding);
+ContentCoding	negotiateCoding(const Request &req);
+const char	*codingName(ContentCoding coding);
+bool	isCompressible(const Route &route, const std::string &contentType, std::size_t length);
+bool	compressBody(const std::string &in, std::string &out, ContentCoding coding, int level);
+void	compressResponse(const Request &req, const Route &route, Response &res);
+
+#endif
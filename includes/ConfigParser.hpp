@@ -20,20 +20,35 @@ class ConfigParser
 
 		// Getters
 		const std::vector<ServerConfig> &getServers(void) const;
+		int		getWorkerThreads(void) const;
+		int		getWorkerProcesses(void) const;
+		bool	getCpuAffinity(void) const;
 
 		void	parse(void);
 
 	private:
 		std::string _filename;
 		std::vector<ServerConfig> _servers;
+		int	_workerThreads;
+		int	_workerProcesses;
+		bool	_cpuAffinity;
 		
 		std::string cleanLine(const std::string &line);
+		int		parseWorkerCount(const std::vector<std::string> &tokens);
+		bool	parseCpuAffinity(const std::vector<std::string> &tokens);
 		void	parseServerBlock(std::istream &in);
 		std::vector<std::string> tokenize(const std::string &line);
 		void	parseHostDirective(ServerConfig &server, const std::vector<std::string> &tokens, bool &hostSet);
 		void	parsePortDirective(ServerConfig &server, const std::vector<std::string> &tokens, bool &portSet);
 		void	parseServerName(ServerConfig &server, const std::vector<std::string> &tokens);
 		void 	parseErrorPage(ServerConfig &server, const std::vector<std::string> &tokens);
+		void	parseKeepaliveTimeout(ServerConfig &server, const std::vector<std::string> &tokens);
+		void	parseKeepaliveRequests(ServerConfig &server, const std::vector<std::string> &tokens);
+		int		parseTimeout(const std::vector<std::string> &tokens);
+		void	parseClientBodyBufferSize(ServerConfig &server, const std::vector<std::string> &tokens);
+		void	parseOpenFileCache(ServerConfig &server, const std::vector<std::string> &tokens);
+		void	parseOpenFileCacheErrors(ServerConfig &server, const std::vector<std::string> &tokens);
+		void	parseContentCache(ServerConfig &server, const std::vector<std::string> &tokens);
 		void	parseLocation(ServerConfig &server, std::istream &in, const std::vector<std::string> &tokens);
 		void	parseLocationBlock(std::istream &in, Route &route);
 		void	handleRootDirective(const std::vector<std::string>& tokens, Route& route, bool& rootSet);
@@ -44,6 +59,12 @@ class ConfigParser
 		void	handleUploadDirDirective(const std::vector<std::string>& tokens, Route& route, bool& uploadDirSet);
 		void	handleClientMaxBodyDirective(const std::vector<std::string>& tokens, Route& route);
 		void	handleCGIDirective(const std::vector<std::string>& tokens, Route& route);
+		void	handleContentCacheStatusDirective(const std::vector<std::string>& tokens, Route& route);
+		void	handleGzipStaticDirective(const std::vector<std::string>& tokens, Route& route);
+		void	handleGzipDirective(const std::vector<std::string>& tokens, Route& route);
+		void	handleExpiresDirective(const std::vector<std::string>& tokens, Route& route);
+		long	parseTimeValue(const std::string &value);
+		void	handleAddHeaderDirective(const std::vector<std::string>& tokens, Route& route);
 
 };
 
@@ -0,0 +1,72 @@
+#ifndef CONNECTION_HPP
+#define CONNECTION_HPP
+
+#include "common.hpp"
+#include "TimerWheel.hpp"
+#include "Buffer.hpp"
+#include "RequestParser.hpp"
+#include "ServerConfig.hpp"
+#include "OutputQueue.hpp"
+
+class Server;
+
+// Everything ServerManager keeps about one registered fd, in one place
+// Listening sockets get a Connection too (isListener), so every event's user
+// data is a Connection*
+struct Connection
+{
+	int		fd;
+	bool	isListener;
+	const Server	*server; // listener that accepted the client (or the listener itself)
+	Buffer	input; // raw data received, possibly several pipelined requests; read into directly
+	RequestParser	parser; // progress through the request at the front of input
+	Request	request; // filled in by the parser as the request arrives
+	const ServerConfig	*config; // virtual server and location matched once the header is in
+	Route	route;
+	OutputQueue	output; // queued responses not sent yet, in request order
+	bool	keepAlive; // the connection persists after the queued responses
+	bool	closeAfterFlush; // a queued response announced "Connection: close"; the connection closes once it is sent
+	int		keepAliveTimeout; // seconds, when keepAlive
+	std::size_t	requestCount; // requests served on this connection
+	bool	writeWatched; // socket filled up; waiting for writability
+	bool	readQueued; // read budget ran out with data still waiting in the socket
+	bool	readPaused; // too much output is waiting on the client; the socket is not read meanwhile
+	TimerWheel::Timer	timer; // the one timeout the connection is waiting on
+	unsigned long	generation; // bumped each time the slot is acquired; kept across reset()
+	Connection	*nextFree;
+
+	Connection(void);
+	void	reset(void);
+};
+
+// fd-indexed table of Connections
+// Connections are allocated in blocks and recycled through a free list, so
+// accepting and closing clients does not allocate once the pool has warmed up;
+// their receive buffers come from the pool's BufferPool for the same reason
+class ConnectionPool
+{
+	public:
+		// Constructor
+		ConnectionPool(void);
+
+		// Destructor
+		~ConnectionPool(void);
+
+		// Others
+		Connection	*acquire(int fd);
+		void	release(Connection *conn);
+		Connection	*find(int fd) const;
+
+	private:
+		std::vector<Connection*> _byFd;
+		std::vector<Connection*> _blocks;
+		BufferPool	_buffers;
+		Connection	*_freeList;
+
+		void	grow(void);
+
+		ConnectionPool(const ConnectionPool &obj);
+		ConnectionPool &operator=(const ConnectionPool &obj);
+};
+
+#endif
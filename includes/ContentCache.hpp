@@ -0,0 +1,71 @@
+#ifndef CONTENTCACHE_HPP
+#define CONTENTCACHE_HPP
+
+#include "common.hpp"
+#include "OpenFileCache.hpp"
+#include "SharedBuffer.hpp"
+#include <list>
+
+// A static file's response rendered ahead, status line, headers and body, as it
+// goes on the wire but for the fields set per response (Connection, Expires, ...)
+struct CachedContent
+{
+	SharedBuffer	*rendered; // a reference is held by the cache
+	std::size_t	headerLength; // blank line included
+	time_t	mtime; // of the file it was rendered from
+	ino_t	inode;
+	std::size_t	size;
+
+	CachedContent(void): rendered(NULL), headerLength(0), mtime(0), inode(0), size(0) {}
+};
+
+// LRU cache of rendered responses for small static files, bounded in bytes
+// One cache per virtual server and event loop, so it needs no locking
+// Every connection serving a hit sends the same buffer, without copying it;
+// an entry is dropped as soon as a lookup finds its file with another mtime,
+// inode or size, and the least recently used ones go when the cache is full
+// Hits and misses are counted to tune content_cache; content_cache_status shows them
+class ContentCache
+{
+	public:
+		// Constructor
+		ContentCache(std::size_t maxSize, std::size_t maxFileSize);
+
+		// Destructor
+		~ContentCache(void);
+
+		// Getters
+		std::size_t	getMaxFileSize(void) const;
+		std::size_t	getSize(void) const;
+		std::size_t	getEntryCount(void) const;
+		unsigned long	getHits(void) const;
+		unsigned long	getMisses(void) const;
+
+		// Others
+		const CachedContent	*find(const std::string &key, const OpenFile &file);
+		const CachedContent	*insert(const std::string &key, const OpenFile &file, std::string &rendered, std::size_t headerLength);
+		void	remove(const std::string &key);
+
+	private:
+		struct Entry
+		{
+			CachedContent	content;
+			std::list<std::string>::iterator	lru;
+		};
+
+		std::size_t	_maxSize;
+		std::size_t	_maxFileSize;
+		std::size_t	_size; // bytes of all rendered responses
+		unsigned long	_hits;
+		unsigned long	_misses;
+		std::map<std::string, Entry> _entries;
+		std::list<std::string> _lru; // keys, most recently used first
+
+		void	erase(std::map<std::string, Entry>::iterator it);
+
+		ContentCache(void);
+		ContentCache(const ContentCache &obj);
+		ContentCache &operator=(const ContentCache &obj);
+};
+
+#endif
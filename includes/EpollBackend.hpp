@@ -0,0 +1,40 @@
+#ifndef EPOLLBACKEND_HPP
+#define EPOLLBACKEND_HPP
+
+#include "IEventBackend.hpp"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+
+// Edge-triggered epoll backend: cost per wait is O(ready), not O(max_fd)
+class EpollBackend : public IEventBackend
+{
+	public:
+		// Constructor
+		EpollBackend(void);
+
+		// Destructor
+		virtual ~EpollBackend(void);
+
+		// Others
+		virtual bool	add(int fd, int events, void *data);
+		virtual bool	modify(int fd, int events, void *data);
+		virtual void	remove(int fd);
+		virtual int		wait(std::vector<Event> &ready, int timeoutMs);
+		virtual const char	*getName(void) const;
+
+	private:
+		int	_epollFD;
+		std::vector<void*> _userData; // indexed by fd
+		std::vector<struct epoll_event> _events;
+
+		bool	control(int op, int fd, int events, void *data);
+
+		EpollBackend(const EpollBackend &obj);
+		EpollBackend &operator=(const EpollBackend &obj);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef IEVENTBACKEND_HPP
+#define IEVENTBACKEND_HPP
+
+#include "common.hpp"
+
+// Readiness notification layer used by ServerManager's event loop.
+// Each registered fd carries an opaque user data pointer that is handed back
+// with every event, so the loop never has to search for the owner of an fd.
+// Backends report readiness edge-style: callers must drain reads and writes
+// until EAGAIN before waiting again.
+class IEventBackend
+{
+	public:
+		enum
+		{
+			EVENT_READ = 1,
+			EVENT_WRITE = 2,
+			EVENT_ERROR = 4
+		};
+
+		struct Event
+		{
+			int		fd;
+			int		events;
+			void	*data;
+		};
+
+		virtual ~IEventBackend(void) {}
+
+		virtual bool	add(int fd, int events, void *data) = 0;
+		virtual bool	modify(int fd, int events, void *data) = 0;
+		virtual void	remove(int fd) = 0;
+		virtual int		wait(std::vector<Event> &ready, int timeoutMs) = 0;
+		virtual const char	*getName(void) const = 0;
+};
+
+IEventBackend	*createEventBackend(void);
+
+#endif
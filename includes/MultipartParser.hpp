@@ -0,0 +1,85 @@
+#ifndef MULTIPARTPARSER_HPP
+#define MULTIPARTPARSER_HPP
+
+#include "common.hpp"
+
+#define MAX_PART_HEADER_SIZE 8192
+
+struct UploadedFile {
+    std::string filename; // as sent by the client
+    std::string path; // where it was saved in the upload_dir
+    std::size_t size;
+
+    UploadedFile(void): filename(), path(), size(0) {}
+};
+
+// Push-style multipart/form-data parser for uploads
+// feed() takes the body a piece at a time as it comes off the socket; file
+// parts are written straight to their final file in the upload_dir and only
+// a delimiter's worth of bytes is held back between pieces, so memory use
+// does not depend on the size of the files
+// Form fields are collected in memory, each up to maxFieldSize (413 beyond)
+// Files of an upload that never reaches its closing delimiter are removed by reset()
+class MultipartParser
+{
+	public:
+		// Constructor
+		MultipartParser(void);
+		MultipartParser(const MultipartParser &obj);
+
+		// Destructor
+		~MultipartParser(void);
+
+		// Operators
+		MultipartParser &operator=(const MultipartParser &obj);
+
+		// Getters
+		bool	isActive(void) const;
+		bool	isComplete(void) const;
+		int		getErrorCode(void) const;
+		std::size_t	getReceived(void) const;
+		const std::map<std::string, std::string> &getFields(void) const;
+		const std::map<std::string, std::vector<UploadedFile> > &getFiles(void) const;
+
+		// Others
+		bool	start(const std::string &contentType, const std::string &uploadDir, std::size_t maxFieldSize);
+		bool	feed(const char *data, std::size_t length);
+		void	reset(void);
+
+	private:
+		enum State
+		{
+			PREAMBLE,
+			DELIMITER_END, // after a delimiter: CRLF for another part, "--" for the last
+			PART_HEADERS,
+			PART_DATA,
+			EPILOGUE
+		};
+
+		State	_state;
+		bool	_active;
+		bool	_complete;
+		int		_errorCode;
+		std::string	_delimiter; // CRLF "--" boundary
+		std::string	_uploadDir;
+		std::size_t	_maxFieldSize; // largest form field value held in memory
+		std::string	_pending; // bytes not parsed yet; at most a partial delimiter in PART_DATA
+		std::size_t	_received;
+		std::string	_fieldName; // part being received
+		std::string	_fieldValue;
+		UploadedFile	_file;
+		int		_fd; // open while a file part is received
+		std::map<std::string, std::string> _fields;
+		std::map<std::string, std::vector<UploadedFile> > _files;
+
+		bool	parse(void);
+		bool	parsePartData(void);
+		bool	parsePartHeaders(std::size_t headerEnd);
+		bool	openFile(const std::string &filename);
+		bool	writePart(const char *data, std::size_t length);
+		void	endPart(void);
+		void	closeFile(void);
+		bool	fail(int code);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef OPENFILECACHE_HPP
+#define OPENFILECACHE_HPP
+
+#include "common.hpp"
+#include <list>
+
+// What StaticFileHandler found for a request path: the file to serve, already
+// open and checked to be inside the location's root, or the error to answer with
+struct OpenFile
+{
+	int		status; // 0 when the file can be served, otherwise the error code (404, 403)
+	int		fd; // owned by the cache while the entry is cached
+	std::string	path; // file served, once a directory's index has been resolved
+	std::size_t	size;
+	time_t	mtime;
+	ino_t	inode;
+	std::string	mimeType;
+	std::string	etag; // validators, rendered once from the stat data
+	std::string	lastModified;
+	std::string	contentEncoding; // "gzip" for a gzip_static variant, else empty
+
+	OpenFile(void): status(0), fd(-1), path(), size(0), mtime(0), inode(0), mimeType(), etag(), lastModified(), contentEncoding() {}
+};
+
+// LRU cache of static file lookups, as NGINX's open_file_cache
+// One cache per virtual server and event loop, so it needs no locking
+// A hit serves the file without any stat(), realpath() or open(): the entry
+// keeps the file open, and is trusted for open_file_cache_valid seconds before
+// the path is looked up again; entries unused for the inactive time are dropped
+// and the least recently used one goes when the cache is full
+class OpenFileCache
+{
+	public:
+		// Constructor
+		OpenFileCache(std::size_t maxEntries, int inactive, int valid, bool cacheErrors);
+
+		// Destructor
+		~OpenFileCache(void);
+
+		// Getters
+		bool	cachesErrors(void) const;
+
+		// Others
+		const OpenFile	*find(const std::string &key);
+		const OpenFile	*insert(const std::string &key, const OpenFile &file);
+		void	remove(const std::string &key);
+
+	private:
+		struct Entry
+		{
+			OpenFile	file;
+			unsigned long	checkedAt; // when the file was looked up
+			unsigned long	usedAt;
+			std::list<std::string>::iterator	lru;
+		};
+
+		std::size_t	_maxEntries;
+		unsigned long	_inactiveMs;
+		unsigned long	_validMs;
+		bool	_cacheErrors;
+		std::map<std::string, Entry> _entries;
+		std::list<std::string> _lru; // keys, most recently used first
+
+		void	expire(unsigned long now);
+		void	erase(std::map<std::string, Entry>::iterator it);
+
+		OpenFileCache(void);
+		OpenFileCache(const OpenFileCache &obj);
+		OpenFileCache &operator=(const OpenFileCache &obj);
+};
+
+#endif
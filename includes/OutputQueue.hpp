@@ -0,0 +1,90 @@
+#ifndef OUTPUTQUEUE_HPP
+#define OUTPUTQUEUE_HPP
+
+#include "common.hpp"
+#include "Response.hpp"
+#include "SharedBuffer.hpp"
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+// A connection's pending output, in the order it goes on the wire, as a list
+// of segments:
+// - bytes copied into the queue's own buffer (response headers, small bodies)
+// - strings handed over whole (large bodies), never copied
+// - static memory that outlives the queue
+// - ranges of reference-counted buffers, e.g. responses held by a cache
+// - file ranges, sent with sendfile()
+// Consecutive memory segments are flushed with one writev(), so pipelined
+// responses and a header with its body leave in a single syscall
+class OutputQueue
+{
+	public:
+		// Constructor
+		OutputQueue(void);
+		OutputQueue(const OutputQueue &obj);
+
+		// Destructor
+		~OutputQueue(void);
+
+		// Operators
+		OutputQueue &operator=(const OutputQueue &obj);
+
+		// Getters
+		bool	empty(void) const;
+		std::size_t	size(void) const;
+		std::size_t	fileCount(void) const;
+
+		// Others
+		char	*appendSpace(std::size_t length);
+		void	append(const char *data, std::size_t length);
+		void	append(const std::string &data);
+		void	appendOwned(std::string &data);
+		void	appendStatic(const char *data, std::size_t length);
+		void	appendShared(SharedBuffer *buffer, std::size_t offset, std::size_t length);
+		void	appendFile(const FileRange &file);
+		ssize_t	send(int fd);
+		void	clear(void);
+
+	private:
+		enum SegmentKind
+		{
+			SEGMENT_BUFFER, // range of _buffer
+			SEGMENT_OWNED, // owned string
+			SEGMENT_STATIC,
+			SEGMENT_SHARED,
+			SEGMENT_FILE
+		};
+
+		struct Segment
+		{
+			SegmentKind	kind;
+			std::size_t	offset; // into _buffer, owned or data; advanced as it is sent
+			std::size_t	length; // bytes left
+			std::string	owned;
+			const char	*data; // SEGMENT_STATIC
+			SharedBuffer	*shared; // SEGMENT_SHARED; a reference is held until it is sent
+			FileRange	file; // SEGMENT_FILE; file.offset and file.length advance instead
+
+			Segment(SegmentKind segmentKind);
+		};
+
+		std::string	_buffer;
+		std::vector<Segment> _segments;
+		std::size_t	_head; // first segment not fully sent
+		std::size_t	_size; // bytes left in all segments
+		std::size_t	_files; // file segments queued
+
+		const char	*memoryOf(const Segment &segment) const;
+		ssize_t	sendMemory(int fd);
+		ssize_t	sendFile(int fd);
+		void	consume(std::size_t sent);
+		void	popSegment(void);
+		void	compact(void);
+		void	retainSegments(void);
+};
+
+#endif
@@ -2,16 +2,29 @@
 #define REQUEST_HPP
 
 #include "common.hpp"
+#include "Buffer.hpp"
+#include "RequestBody.hpp"
+#include "MultipartParser.hpp"
 
 #define MAX_CHUNK_SIZE 100000000
+#define MAX_CONTENT_LENGTH_DIGITS 18 // any such value fits in a 64-bit size_t
 #define MAX_URI_LENGTH 2048
+#define MAX_REQUEST_LINE 8192
+#define MAX_HEADER_SIZE 32768 // request line and headers together
 
-struct UploadedFile {
-    std::string filename;
-    std::string content;
+struct HeaderField {
+    Slice name;
+    Slice value;
 };
 
 
+// Method, target, version and headers are slices of the connection's
+// receive buffer; they are copied into strings only when a getter asks for
+// them, so parsing a request allocates nothing once the Request has been
+// reused (reset() keeps its capacity)
+// The body is a RequestBody, kept in the receive buffer, in memory or on disk,
+// except for a multipart upload, which is streamed into the upload_dir
+// The slices are valid until the request is consumed from the buffer
 class Request
 {
     public:
@@ -29,48 +42,60 @@ class Request
         const std::string &getMethod() const;
         const std::string &getTarget() const;
         const std::string &getVersion() const;
-        const std::map<std::string, std::string>& getHeaders() const;
         std::string getHeader(const std::string &key) const;
-        const std::string &getBody() const;
+        std::string getHeader(const char *key) const;
+        void getHeaderValues(const char *key, std::vector<std::string> &values) const;
+        const RequestBody &getBody() const;
+        std::size_t getBodySize(void) const;
         int getParseErrorCode(void) const;
         std::string getQueryString(void) const;
+        bool isKeepAlive(void) const;
     	const std::map<std::string, std::vector<UploadedFile> >& getUploadedFiles() const;
 
+        // Setters
+        void setBodySlice(const Slice &body);
+        bool appendBody(const char *data, std::size_t length);
+        void setBodyBufferSize(std::size_t bufferSize);
+        bool startMultipartUpload(const std::string &uploadDir);
+
         // Other functions
-        bool    parse(const std::string &raw); 
+        bool parseRequestLine(const Buffer &source, const Slice &line);
+        bool parseHeaderLine(const Buffer &source, const Slice &line);
+        bool keepsBodyInBuffer(std::size_t length) const;
+        void reset(void);
         bool validateBody(std::size_t maxBodySize);
         void    printMembers(void) const;
         const std::map<std::string, std::string>& getFormData() const;
 
     private:
-        std::string _method;
-        std::string _target;
-        std::string _version;
-        std::map<std::string, std::string> _headers;
-        std::string _body;
+        const Buffer *_source; // receive buffer the slices point into
+        Slice _methodSlice;
+        Slice _targetSlice;
+        Slice _versionSlice;
+        std::vector<HeaderField> _headers;
+        mutable std::string _method; // request line parts, copied on first use
+        mutable std::string _target;
+        mutable std::string _version;
+        mutable bool _lineCopied;
+        RequestBody _body;
+        MultipartParser _multipart;
         int _parseErrorCode;
         std::map<std::string, std::string> _formData;
-        std::map<std::string, std::vector<UploadedFile> > _uploadedFiles;
 
-        bool checkMethod(const std::string &method);
-        bool checkTarget(const std::string &target);
-        bool isValidPercentEncoding(const std::string& uri);
-        bool checkVersion(const std::string &version);
-        bool parseRequestLine(std::istream &stream);
-        bool parseHeaders(std::istream &stream);
+        const char *sliceData(const Slice &slice) const;
+        bool sliceEquals(const Slice &slice, const char *text) const;
+        const HeaderField *findHeader(const char *key) const;
+        void copyRequestLine(void) const;
+        bool checkMethod(const Slice &method);
+        bool checkTarget(const Slice &target);
+        bool isValidPercentEncoding(const char *uri, std::size_t length);
+        bool checkVersion(const Slice &version);
         bool isSupportedMethod(const std::string &method);
-        bool handleChunkedEncoding(void);
         bool checkRequiredLengthHeader(void);
         bool checkContentLength(void);
         bool checkUploadedFileSizes(std::size_t maxBodySize);
         bool checkTotalBodySize(std::size_t maxBodySize);
-        bool decodeChunkedBody(void);
-        void parseBody(void);
-        bool parseMultipartFormData(const std::string &boundary);
-        bool extractContentDisposition(const std::string &headers, std::string &contentDisposition) const;
-        bool extractFieldNames(const std::string &contentDisposition, std::string &name, std::string &filename) const;
-        bool extractPartContent(std::string::size_type &prevPos, std::string::size_type &nextBoundaryPos,
-            const std::string &boundary, std::string &partContent) const;
+        bool parseBody(void);
 };
 
 #endif
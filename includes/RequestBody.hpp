@@ -0,0 +1,84 @@
+#ifndef REQUESTBODY_HPP
+#define REQUESTBODY_HPP
+
+#include "common.hpp"
+#include "Buffer.hpp"
+
+// Template for spooled bodies; the file is unlinked as soon as it is created
+#define BODY_TEMP_TEMPLATE "/tmp/webserv_body_XXXXXX"
+
+// Holds a request body while its request is handled
+// A Content-Length body that fits in client_body_buffer_size is left in the
+// connection's receive buffer as a slice, a chunked body is decoded into memory,
+// and anything larger than client_body_buffer_size goes to an unlinked temp file
+// as it arrives, so a large upload costs disk space rather than RAM
+// Handlers read it through a BodyReader, wherever it is stored
+class RequestBody
+{
+	public:
+		// Constructor
+		RequestBody(void);
+		RequestBody(const RequestBody &obj);
+
+		// Destructor
+		~RequestBody(void);
+
+		// Operators
+		RequestBody &operator=(const RequestBody &obj);
+
+		// Getters
+		std::size_t	size(void) const;
+		bool	empty(void) const;
+		bool	isSpooled(void) const;
+		std::size_t	getBufferSize(void) const;
+
+		// Setters
+		void	setBufferSize(std::size_t bufferSize);
+		void	setSlice(const Buffer &source, const Slice &slice);
+
+		// Others
+		bool	append(const char *data, std::size_t length);
+		ssize_t	read(std::size_t offset, char *dst, std::size_t length) const;
+		bool	truncate(std::size_t length);
+		void	reset(void);
+
+	private:
+		const Buffer	*_source; // receive buffer holding the slice
+		Slice	_slice;
+		std::string	_memory;
+		int		_fd; // temp file, or -1 while the body is in memory
+		std::size_t	_size;
+		std::size_t	_bufferSize; // largest body kept in memory
+
+		bool	spill(void);
+		bool	writeFile(const char *data, std::size_t length);
+		void	closeFile(void);
+};
+
+// Reads a RequestBody sequentially from its start
+class BodyReader
+{
+	public:
+		// Constructor
+		explicit BodyReader(const RequestBody &body);
+		BodyReader(const BodyReader &obj);
+
+		// Destructor
+		~BodyReader(void);
+
+		// Getters
+		std::size_t	remaining(void) const;
+
+		// Others
+		ssize_t	read(char *dst, std::size_t length);
+		bool	readAll(std::string &out);
+
+	private:
+		const RequestBody	&_body;
+		std::size_t	_offset;
+
+		BodyReader(void);
+		BodyReader &operator=(const BodyReader &obj);
+};
+
+#endif
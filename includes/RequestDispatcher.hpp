@@ -8,6 +8,7 @@
 #include "CgiHandler.hpp"
 #include "UploadHandler.hpp"
 #include "RedirectHandler.hpp"
+#include "CacheStatusHandler.hpp"
 #include "FormHandler.hpp"
 #include "ServerConfig.hpp"
 
@@ -21,7 +22,9 @@ class RequestDispatcher
 		~RequestDispatcher();
 		
 		// Others
-		IRequestHandler *selectHandler(const Request &req, const Route &route, const ServerConfig &config) const;
+		IRequestHandler *selectHandler(const Request &req, const Route &route, const ServerConfig &config, const FileCaches &caches,
+			unsigned long &rangeResponses) const;
+		bool isMultipartUpload(const Request &req, const Route &route) const;
 	
 	private:
 		std::string getFileExtension(const std::string &path) const;
@@ -0,0 +1,94 @@
+#ifndef REQUESTPARSER_HPP
+#define REQUESTPARSER_HPP
+
+#include "common.hpp"
+#include "Buffer.hpp"
+#include "Request.hpp"
+
+// Incremental HTTP/1.x request framing
+// parse() is called each time more bytes arrive; it resumes where it stopped,
+// so every byte is scanned once however slowly the request trickles in
+// Request line and header lines are handed to the Request as soon as they are
+// complete; parsing pauses once after the header (PARSE_HEADERS_COMPLETE) so the
+// caller can set the body limit for the matched location, or refuse the request
+// and have its body discarded
+// A chunked body is decoded into the Request as it arrives and its raw bytes
+// are dropped from the buffer, as is a Content-Length body that the Request
+// does not keep in the buffer (spooled to disk or streamed into an upload);
+// anything else stays in the buffer until the caller consumes
+// getRequestLength() bytes and calls reset() for the next request
+class RequestParser
+{
+	public:
+		enum Status
+		{
+			PARSE_INCOMPLETE,
+			PARSE_HEADERS_COMPLETE,
+			PARSE_COMPLETE,
+			PARSE_ERROR
+		};
+
+		// Constructor
+		RequestParser(void);
+		RequestParser(const RequestParser &obj);
+
+		// Destructor
+		~RequestParser(void);
+
+		// Operators
+		RequestParser &operator=(const RequestParser &obj);
+
+		// Setters
+		void	setMaxBodySize(std::size_t maxBodySize);
+		void	discardBody(void);
+
+		// Getters
+		int		getErrorCode(void) const;
+		std::size_t	getRequestLength(void) const;
+		bool	inBody(void) const;
+		bool	hasBodyLength(void) const;
+		bool	isChunked(void) const;
+		std::size_t	getContentLength(void) const;
+		bool	discardsBody(void) const;
+
+		// Others
+		Status	parse(Buffer &input, Request &request);
+		void	reset(void);
+
+	private:
+		enum State
+		{
+			REQUEST_LINE,
+			HEADER_LINE,
+			BODY,
+			CHUNK_SIZE,
+			CHUNK_DATA,
+			CHUNK_DATA_END,
+			CHUNK_TRAILER,
+			DONE
+		};
+
+		State	_state;
+		std::size_t	_pos; // next byte to scan
+		std::size_t	_lineStart; // start of the line being scanned
+		std::size_t	_bodyStart;
+		std::size_t	_remaining; // body or chunk bytes still expected
+		bool	_chunked;
+		bool	_spooled; // Content-Length body moved out of the buffer as it arrives
+		bool	_discard; // the request was answered early; its body is dropped
+		bool	_hasLength; // Content-Length or chunked framing was given
+		std::size_t	_contentLength;
+		std::size_t	_bodySize; // decoded chunked payload so far
+		std::size_t	_maxBodySize;
+		int		_errorCode;
+
+		bool	nextLine(const Buffer &input, Slice &line);
+		bool	startBody(Request &request);
+		bool	checkTransferEncoding(const std::vector<std::string> &values);
+		bool	parseContentLength(const std::vector<std::string> &values);
+		bool	parseChunkSize(const Buffer &input, const Slice &line);
+		void	discardDecoded(Buffer &input);
+		Status	fail(int code);
+};
+
+#endif
@@ -3,15 +3,67 @@
 
 #include "common.hpp"
 #include "ServerConfig.hpp"
+#include "SharedBuffer.hpp"
+
+// Part of an open file sent as a response body
+struct FileRange
+{
+	int		fd; // -1 when there is none
+	off_t	offset;
+	std::size_t	length;
+
+	FileRange(void): fd(-1), offset(0), length(0) {}
+};
+
+// Piece of a body sent as a sequence, e.g. a multipart/byteranges body:
+// the bytes in data, or a file range when file.fd is set
+struct BodyPart
+{
+	std::string	data;
+	FileRange	file;
+};
+
+// One response header field, stored with its name in canonical case
+struct ResponseHeader
+{
+	std::string	name;
+	std::string	value;
+};
+
+// A response body is either a string, a FileRange or a sequence of BodyParts
+// mixing both; a file is never read into memory, the connection sends it
+// straight from the page cache
+// A response can also be fully rendered ahead, header and body, in a
+// SharedBuffer held by a cache; the fields set on the Response itself (Connection,
+// Expires, ...) are added to it when sent
+// The status line comes from a table rendered once at startup, the first
+// header fields are kept inside the Response itself, and the header is
+// serialized in one pass into memory sized for it exactly
+// Content-Length is always computed from the body
 class Response
 {
 	private:
-		std::string _httpVersion;
+		enum { INLINE_HEADERS = 8 };
+
 		int _statusCode;
-		std::string _statusLine;
-		std::map<std::string, std::string> _headers;
+		std::string _customStatusLine; // only for a non-standard reason phrase
+		ResponseHeader _inlineHeaders[INLINE_HEADERS];
+		std::vector<ResponseHeader> _extraHeaders; // fields after the inline ones
+		std::size_t _headerCount;
 		std::string _body;
+		FileRange _file; // owned; closed unless taken with releaseFile()
+		std::vector<BodyPart> _parts; // their descriptors are owned like _file's
+		SharedBuffer *_rendered; // a reference is held; NULL unless the response was rendered ahead
+		std::size_t _renderedHeaderLength; // header part of _rendered, blank line included
 		
+		ResponseHeader &headerAt(std::size_t i);
+		const ResponseHeader &headerAt(std::size_t i) const;
+		const std::string &statusLine(void) const;
+		bool hasContentLength(void) const;
+		std::size_t bodySize(void) const;
+		void copyFrom(const Response &obj);
+		void closeFile(void);
+		void dropRendered(void);
 		void setDefaultErrorBody(int code, const std::string &message);
 
 	public:
@@ -26,15 +78,36 @@ class Response
 		Response &operator=(const Response &obj);
 
 		// Setters
+		void setStatus(int code);
 		void setStatusLine(int code, const std::string &message);
 		void setHeader(const std::string &key, const std::string &value);
 		void setBody(const std::string &body);
 		void setError(int code, const ServerConfig &config);
 		void setFile(const std::string &body, const std::string &mimeType);
+		void setFile(int fd, std::size_t size, const std::string &mimeType);
+		void setFileBody(int fd, off_t offset, std::size_t length);
+		void setRendered(SharedBuffer *rendered, std::size_t headerLength);
+		void addBodyPart(const std::string &data);
+		void addFileBodyPart(int fd, off_t offset, std::size_t length);
 	
 		// Other functions
-		std::string toString(void) const;
+		std::size_t headerSize(void) const;
+		char *serializeHeader(char *dst) const;
+		std::size_t fieldsSize(void) const;
+		char *serializeFields(char *dst) const;
+		void releaseBody(std::string &out);
 		bool isError(void) const;
+		void applyCachePolicy(const Route &route);
+		int getStatusCode(void) const;
+		std::string getHeader(const std::string &key) const;
+		const std::string &getBody(void) const;
+		bool hasStringBody(void) const;
+		bool hasFile(void) const;
+		FileRange releaseFile(void);
+		bool hasParts(void) const;
+		void releaseParts(std::vector<BodyPart> &out);
+		SharedBuffer *getRendered(void) const;
+		std::size_t getRenderedHeaderLength(void) const;
 
 };
 
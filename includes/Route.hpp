@@ -3,6 +3,23 @@
 
 #include "common.hpp"
 
+// How long clients and shared caches may keep a location's responses (expires)
+enum ExpiresPolicy
+{
+	EXPIRES_OFF,
+	EXPIRES_EPOCH, // already expired: Cache-Control: no-cache
+	EXPIRES_MAX, // as far ahead as NGINX's "max"
+	EXPIRES_TIME // the given number of seconds from the response; negative means no-cache
+};
+
+// A field set by add_header; without always, only on successful and redirect responses
+struct AddedHeader
+{
+	std::string	name;
+	std::string	value;
+	bool	always;
+};
+
 class Route
 {
 	public:
@@ -26,6 +43,14 @@ class Route
 		void	setRedirect(int statusCode, const std::string &url);
 		void	addCGI(const std::string &ext, const std::string &exec);
 		void	setClientMaxBodySize(std::size_t clientMaxBodySize);
+		void	setCacheStatus(bool cacheStatus);
+		void	setGzipStatic(bool gzipStatic);
+		void	setGzip(bool gzip);
+		void	setGzipCompLevel(int level);
+		void	setGzipMinLength(std::size_t length);
+		void	addGzipType(const std::string &type);
+		void	setExpires(ExpiresPolicy policy, long seconds, bool immutable);
+		void	addHeader(const AddedHeader &header);
 
 		// Getters
 		const std::string &getLocation(void) const;
@@ -40,6 +65,16 @@ class Route
 		const std::map<std::string, std::string> &getCGI(void) const;
 		std::size_t getClientMaxBodySize(void) const;
 		bool hasClientMaxBodySize(void) const;
+		bool isCacheStatus(void) const;
+		bool getGzipStatic(void) const;
+		bool getGzip(void) const;
+		int getGzipCompLevel(void) const;
+		std::size_t getGzipMinLength(void) const;
+		const std::vector<std::string> &getGzipTypes(void) const;
+		ExpiresPolicy getExpiresPolicy(void) const;
+		long getExpiresSeconds(void) const;
+		bool isExpiresImmutable(void) const;
+		const std::vector<AddedHeader> &getAddedHeaders(void) const;
 
 		// Others
 		bool isMethodAllowed(const std::string &method) const;
@@ -57,6 +92,16 @@ class Route
 		std::map<std::string, std::string> _cgi;
 		std::size_t _clientMaxBodySize;
 		bool	_hasClientMaxBodySize;
+		bool	_cacheStatus; // content_cache_status: the location reports the server's cache counters
+		bool	_gzipStatic; // file.gz is served in place of file to clients accepting gzip
+		bool	_gzip; // bodies are compressed on the fly for clients accepting gzip or deflate
+		int	_gzipCompLevel; // zlib level, 1 (fastest) to 9 (smallest)
+		std::size_t	_gzipMinLength;
+		std::vector<std::string> _gzipTypes; // MIME types compressed besides text/html; "*" for any
+		ExpiresPolicy	_expiresPolicy;
+		long	_expiresSeconds; // EXPIRES_TIME
+		bool	_expiresImmutable; // Cache-Control also says immutable, for fingerprinted assets
+		std::vector<AddedHeader> _addedHeaders;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef SELECTBACKEND_HPP
+#define SELECTBACKEND_HPP
+
+#include "IEventBackend.hpp"
+#include <sys/select.h>
+
+// Portable fallback: limited to fds below FD_SETSIZE, O(max_fd) per wait
+class SelectBackend : public IEventBackend
+{
+	public:
+		// Constructor
+		SelectBackend(void);
+
+		// Destructor
+		virtual ~SelectBackend(void);
+
+		// Others
+		virtual bool	add(int fd, int events, void *data);
+		virtual bool	modify(int fd, int events, void *data);
+		virtual void	remove(int fd);
+		virtual int		wait(std::vector<Event> &ready, int timeoutMs);
+		virtual const char	*getName(void) const;
+
+	private:
+		fd_set	_masterReadFds;
+		fd_set	_masterWriteFds;
+		int		_maxFd;
+		std::vector<void*> _userData; // indexed by fd
+
+		void	updateMaxFd(void);
+
+		SelectBackend(const SelectBackend &obj);
+		SelectBackend &operator=(const SelectBackend &obj);
+};
+
+#endif
@@ -21,9 +21,10 @@ class Server
 		// Getters
 		int getServerFD(void) const;
 		const std::vector<ServerConfig> &getConfigs(void) const;
+		const ServerConfig &getDefaultConfig(void) const;
 		
 		// Others
-		void initSocket(void);
+		void initSocket(bool reusePort);
 		const ServerConfig& selectServer(const std::string &hostHeader) const;
 
 	private: 
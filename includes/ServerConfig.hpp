@@ -24,6 +24,16 @@ class ServerConfig
 		void	addErrorPage(int code, const std::string &filepath);
 		void	addRoute(const Route &route);
 		void	setClientMaxBodySize(std::size_t clientMaxBodySize);
+		void	setKeepaliveTimeout(int seconds);
+		void	setKeepaliveRequests(std::size_t maxRequests);
+		void	setClientHeaderTimeout(int seconds);
+		void	setClientBodyTimeout(int seconds);
+		void	setSendTimeout(int seconds);
+		void	setClientBodyBufferSize(std::size_t size);
+		void	setOpenFileCache(std::size_t maxEntries, int inactive);
+		void	setOpenFileCacheValid(int seconds);
+		void	setOpenFileCacheErrors(bool enabled);
+		void	setContentCache(std::size_t size, std::size_t maxFileSize);
 
 		// Getters
 		const std::string &getHost(void) const;
@@ -33,6 +43,18 @@ class ServerConfig
 		const std::map<int, std::string> &getErrorPages(void) const;
 		std::size_t getClientMaxBodySize(void) const;
 		bool hasClientMaxBodySize(void) const;
+		int getKeepaliveTimeout(void) const;
+		std::size_t getKeepaliveRequests(void) const;
+		int getClientHeaderTimeout(void) const;
+		int getClientBodyTimeout(void) const;
+		int getSendTimeout(void) const;
+		std::size_t getClientBodyBufferSize(void) const;
+		std::size_t getOpenFileCacheMax(void) const;
+		int getOpenFileCacheInactive(void) const;
+		int getOpenFileCacheValid(void) const;
+		bool getOpenFileCacheErrors(void) const;
+		std::size_t getContentCacheSize(void) const;
+		std::size_t getContentCacheMaxFile(void) const;
 
 		// Others
 		bool matchRoute(const std::string &target, Route &matchedRoute) const;
@@ -45,6 +67,18 @@ class ServerConfig
 		std::vector<Route> _routes;
 		std::size_t _clientMaxBodySize;
 		bool	_hasClientMaxBodySize;
+		int	_keepaliveTimeout; // seconds an idle persistent connection is kept; 0 disables keep-alive
+		std::size_t	_keepaliveRequests; // requests served on one connection before it is closed
+		int	_clientHeaderTimeout; // seconds to receive a complete request header
+		int	_clientBodyTimeout; // seconds allowed between two reads of a request body
+		int	_sendTimeout; // seconds allowed between two writes to a client that stopped reading
+		std::size_t	_clientBodyBufferSize; // larger request bodies are spooled to a temp file
+		std::size_t	_openFileCacheMax; // static file lookups cached per event loop; 0 disables the cache
+		int	_openFileCacheInactive; // seconds an unused entry is kept
+		int	_openFileCacheValid; // seconds an entry is trusted before the file is looked up again
+		bool	_openFileCacheErrors; // failed lookups (404, 403) are cached too
+		std::size_t	_contentCacheSize; // bytes of rendered responses cached per event loop; 0 disables the cache
+		std::size_t	_contentCacheMaxFile; // larger files are not cached
 
 };
 
@@ -7,6 +7,10 @@
 #include "Request.hpp"
 #include "Response.hpp"
 #include "RequestDispatcher.hpp"
+#include "IEventBackend.hpp"
+#include "TimerWheel.hpp"
+#include "Connection.hpp"
+#include "StaticFileHandler.hpp"
 
 class ServerManager
 {
@@ -23,43 +27,69 @@ class ServerManager
 		ServerManager &operator=(const ServerManager &obj);
 		
 		// Others
-		void	setup(void);
+		void	setup(bool reusePort);
 		void	start(void);
 		
 	private:
+		// What a connection's timer is waiting for
+		enum TimerKind
+		{
+			TIMER_HEADER, // rest of a request header (client_header_timeout)
+			TIMER_BODY, // next part of a request body (client_body_timeout)
+			TIMER_SEND, // client to read queued output (send_timeout)
+			TIMER_KEEPALIVE // next request on an idle connection (keepalive_timeout)
+		};
+
 		std::vector<Server> _servers;
-		std::map<int, const Server*> _clientToServer; // map each client connection FD after accept to Server that accepted it; needed to select right ServerConfig later
-		std::map<int, std::string> _clientBuffers; // raw data received from each client
-		std::map<int, Request> _clientRequests; // parsed request for each clientFD
-		std::map<int, std::string> _clientResponses; // pending response body
-		std::map<int, size_t> _responseOffsets; // How much has been sent 
-		fd_set _master_read_fds;
-		fd_set _master_write_fds;
-		int _max_fd;
+		ConnectionPool *_connections; // created in start(); every registered fd, listeners included
+		IEventBackend *_backend; // created in start(); each fd carries its Connection as user data
+		std::vector<IEventBackend::Event> _events;
+		std::vector<unsigned long> _eventGenerations; // generation of each event's Connection when the batch was returned
+		TimerWheel *_timers; // created in start(); drives every client timeout
+		std::vector<Connection*> _readBacklog; // clients that used up their read budget with data left
+		std::vector<const Server*> _acceptBacklog; // listeners that hit the accept budget with connections still queued
+		std::map<const Server*, unsigned long> _pausedListeners; // listeners backing off after fd exhaustion, and when to resume
+		int _reserveFD; // spare fd released to shed a connection when the process is out of fds
+		std::map<const ServerConfig*, FileCaches> _fileCaches; // open_file_cache and content_cache of each virtual server
+		unsigned long _rangeResponses; // multipart/byteranges responses sent, numbering their boundaries
 
-		void	selectLoop(void);
-		bool	isListeningSocket(int fd) const;
-		void	acceptNewClient(int serverFD);
-		bool	handleClientRead(int fd, int &parseError, Request *tempReq);
-		void	sendErrorResponse(int fd, int errorCode, const Request& request);
-		bool	readFromClient(int fd, std::string& buffer, int& parseError);
-		bool	headersComplete(const std::string& buffer);
-		bool	parseTempHeaders(const std::string& buffer, Request& tempReq);
-		// bool	isBodyComplete(const std::string& buffer, const Request& tempReq);
-		bool isBodyComplete(const std::string& buffer, const Request& tempReq, int &parseError);
+		void	eventLoop(void);
+		void	handleClientEvent(Connection &conn, int events);
+		int		nextWaitTimeout(void) const;
+		void	acceptNewClient(const Server &server);
+		bool	registerClient(int clientFD, const Server &server);
+		void	shedConnection(const Server &server);
+		void	pauseListener(const Server &server);
+		void	resumeListeners(bool force);
+		bool	isClosing(const Connection &conn) const;
+		bool	isBackpressured(const Connection &conn) const;
+		void	pauseReading(Connection &conn);
+		void	resumeReading(Connection &conn);
+		void	processBufferedRequests(Connection &conn);
+		void	sendErrorResponse(Connection &conn, int errorCode, const Request& request);
+		bool	readFromClient(Connection &conn, int& parseError);
+		void	requeueRead(Connection &conn);
 
-		bool	parseFullRequest(const std::string& buffer, Request& requestOut);
-		void	processClientRequest(int clientFD, Request& request);
-		const	ServerConfig* getSelectedConfig(int clientFD, const Request& request);
-		bool	matchRouteOrRespond404(int clientFD, const Request& request, const ServerConfig& config, Route& matchedRoute);
+		void	processClientRequest(Connection &conn, Request& request);
+		void	countRequest(Connection &conn, const Request& request, const ServerConfig& config);
+		const	ServerConfig* getSelectedConfig(const Connection &conn, const Request& request);
 		std::size_t	getMaxBodySize(const Route& route, const ServerConfig& config);
-		bool	validateRequestOrRespondError(int clientFD, Request& request, const ServerConfig& config, std::size_t maxBodySize);
-		void	generateResponseAndBuffer(int clientFD, const Request& request, const Route& route, const ServerConfig& config);
-		void	bufferResponse(int fd, const std::string& responseStr);
-		void	handleClientWrite(int fd);
-		const Server*	getListeningServerByFD(int fd) const;
-		void	cleanupClient(int fd);
-		void	trackMaxFd(int fd);
+		void	prepareBody(Connection &conn);
+		void	rejectRequest(Connection &conn, int code);
+		bool	validateRequestOrRespondError(Connection &conn, Request& request, const ServerConfig& config, std::size_t maxBodySize);
+		const FileCaches	&getFileCaches(const ServerConfig &config);
+		void	clearFileCaches(void);
+		void	generateResponseAndBuffer(Connection &conn, const Request& request, const Route& route, const ServerConfig& config);
+		void	bufferResponse(Connection &conn, Response& response);
+		void	handleClientWrite(Connection &conn);
+		void	watchWritable(Connection &conn, bool enable);
+		void	updateInterest(Connection &conn);
+		void	keepClientAlive(Connection &conn);
+		void	armTimer(Connection &conn, int kind, int seconds);
+		void	armReadTimer(Connection &conn);
+		void	expireTimers(void);
+		void	handleTimeout(Connection &conn, int kind);
+		void	cleanupClient(Connection &conn);
 
 };
 
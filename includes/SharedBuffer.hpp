@@ -0,0 +1,33 @@
+#ifndef SHAREDBUFFER_HPP
+#define SHAREDBUFFER_HPP
+
+#include "common.hpp"
+
+// Immutable bytes shared by reference count, so a cache and every connection
+// sending them use one copy; the last release() frees it
+// Only used within one event loop, so the count is a plain integer
+class SharedBuffer
+{
+	public:
+		// Constructor
+		static SharedBuffer	*create(std::string &data);
+
+		// Getters
+		const char	*data(void) const;
+		std::size_t	size(void) const;
+
+		// Others
+		void	retain(void);
+		void	release(void);
+
+	private:
+		std::string	_data;
+		std::size_t	_refs;
+
+		SharedBuffer(void);
+		~SharedBuffer(void);
+		SharedBuffer(const SharedBuffer &obj);
+		SharedBuffer &operator=(const SharedBuffer &obj);
+};
+
+#endif
@@ -7,14 +7,28 @@
 #include "Response.hpp"
 #include "Route.hpp"
 #include "ServerConfig.hpp"
+#include "OpenFileCache.hpp"
+#include "ContentCache.hpp"
+#include "Compression.hpp"
 
+// The caches a virtual server keeps for static files in one event loop; each is NULL when off
+// Compressed responses go to the content cache, or to a small cache of their own
+// when content_cache is off and a location compresses on the fly
+struct FileCaches
+{
+	OpenFileCache	*openFiles;
+	ContentCache	*content;
+	ContentCache	*compressed;
+
+	FileCaches(void): openFiles(NULL), content(NULL), compressed(NULL) {}
+};
 
 class StaticFileHandler: public IRequestHandler
 {
 	public:
 		// Constructor
 		StaticFileHandler(const StaticFileHandler &obj);
-		StaticFileHandler(const Route &route, const ServerConfig &config);
+		StaticFileHandler(const Route &route, const ServerConfig &config, const FileCaches &caches, unsigned long &rangeResponses);
 		
 		// Destructor
 		virtual ~StaticFileHandler(void);
@@ -24,14 +38,25 @@ class StaticFileHandler: public IRequestHandler
 	private:
 		Route _route;
 		const ServerConfig &_config;
+		FileCaches _caches;
+		unsigned long &_rangeResponses; // multipart/byteranges responses sent by the event loop, numbering their boundaries
 		
+		void serve(const Request &req, Response &res);
 		std::string resolvePath(const Request &req) const;
 		bool isSafePath(const std::string &path) const;
-		bool handleDirectory(const Request &req, Response &res, std::string &path) const;
-		bool handleDelete(Response &res, const std::string &path) const;
-		bool serveFile(Response &res, const std::string &path) const;
+		void handleDirectory(const Request &req, Response &res, const std::string &path) const;
+		void handleDelete(Response &res, const std::string &path) const;
+		const OpenFile *findFile(const std::string &key, const std::string &path, OpenFile &found) const;
+		const OpenFile *findGzipVariant(const std::string &key, const OpenFile &original, OpenFile &found) const;
+		bool lookupFile(const std::string &path, OpenFile &file) const;
+		void serveFile(Response &res, const OpenFile &file, int fd) const;
+		void setFileHeaders(Response &res, const OpenFile &file, ContentCoding coding = CODING_IDENTITY) const;
+		bool isNotModified(const Request &req, const OpenFile &file) const;
+		int selectRanges(const Request &req, const OpenFile &file, std::vector<FileRange> &ranges) const;
+		void serveRanges(Response &res, const OpenFile &file, int fd, const std::vector<FileRange> &ranges) const;
+		bool serveRendered(Response &res, const std::string &key, const OpenFile &file, ContentCoding coding) const;
+		bool renderFile(Response &res, const OpenFile &file, ContentCoding coding) const;
 		bool findIndexFile(const std::string &dir, std::string &indexPath) const;
-		bool readFile(const std::string &path, std::string &content) const;
 		std::string getMimeType(const std::string &filename) const;
 		std::string generateDirectoryListing(const std::string &dirPath, const std::string &uriPath) const;
 		
@@ -0,0 +1,67 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include "common.hpp"
+
+// Hierarchical timing wheel: O(1) schedule, cancel and per-tick expiry
+// A 256-slot root wheel covers the next 256 ticks; three 64-slot outer wheels
+// hold later timers and are cascaded inwards as the root wheel wraps
+// Timers are intrusive: the owner embeds a Timer and must cancel it before
+// destroying it
+class TimerWheel
+{
+	public:
+		struct Timer
+		{
+			Timer	*prev;
+			Timer	*next;
+			unsigned long	expires; // tick at which the timer fires
+			int		fd;
+			int		kind; // owner-defined reason for the timer
+
+			Timer(void);
+		};
+
+		// Constructor
+		TimerWheel(unsigned long tickMs, unsigned long nowMs);
+
+		// Destructor
+		~TimerWheel(void);
+
+		// Others
+		void	schedule(Timer &timer, unsigned long delayMs, unsigned long nowMs);
+		void	cancel(Timer &timer);
+		bool	isScheduled(const Timer &timer) const;
+		void	advance(unsigned long nowMs, std::vector<Timer*> &expired);
+		int		nextTimeout(unsigned long nowMs) const;
+		std::size_t	size(void) const;
+
+	private:
+		enum
+		{
+			ROOT_BITS = 8,
+			LEVEL_BITS = 6,
+			ROOT_SIZE = 1 << ROOT_BITS,
+			LEVEL_SIZE = 1 << LEVEL_BITS,
+			ROOT_MASK = ROOT_SIZE - 1,
+			LEVEL_MASK = LEVEL_SIZE - 1,
+			OUTER_LEVELS = 3
+		};
+
+		Timer	_root[ROOT_SIZE]; // list sentinels
+		Timer	_outer[OUTER_LEVELS][LEVEL_SIZE]; // list sentinels
+		unsigned long	_tickMs;
+		unsigned long	_currentTick; // next tick to be processed
+		std::size_t	_count;
+
+		void	insert(Timer &timer);
+		bool	cascade(int level);
+		static void	link(Timer &head, Timer &timer);
+		static void	unlink(Timer &timer);
+
+		TimerWheel(void);
+		TimerWheel(const TimerWheel &obj);
+		TimerWheel &operator=(const TimerWheel &obj);
+};
+
+#endif
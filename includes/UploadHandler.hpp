@@ -19,11 +19,9 @@ class UploadHandler : public IRequestHandler
 		const Route &_route;
 		const ServerConfig &_config;
 
-		std::string sanitizeFilename(const std::string& filename);
 		std::string generateTimestamp() const;
 
-		bool saveFile(const std::string &filename, const std::string &content) const;
-		bool isSafePath(const std::string &path, const std::string &baseDir) const;
+		bool saveBody(const std::string &filename, const RequestBody &body) const;
 
 		UploadHandler();
 		UploadHandler(const UploadHandler &obj);
@@ -0,0 +1,50 @@
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+#include "common.hpp"
+#include "ServerConfig.hpp"
+#include "ServerManager.hpp"
+#include <pthread.h>
+
+// Runs one independent ServerManager (event loop, listeners, connections and
+// config copies) per worker thread, so nothing is shared on the request path
+// With several worker processes, the master binds the listeners once, forks
+// the workers (each running its threads) and respawns any worker that dies
+class WorkerPool
+{
+	public:
+		// Constructor
+		WorkerPool(const std::vector<ServerConfig> &configs, int workerThreads, int workerProcesses, bool cpuAffinity);
+
+		// Destructor
+		~WorkerPool(void);
+
+		// Others
+		void	setup(void);
+		void	start(void);
+
+	private:
+		std::vector<ServerConfig> _configs;
+		int	_workerThreads;
+		int	_workerProcesses;
+		bool	_cpuAffinity;
+		std::vector<ServerManager*> _managers;
+		std::vector<pid_t> _workerPids; // indexed by worker slot
+		std::vector<time_t> _spawnTimes; // indexed by worker slot
+
+		void	runThreads(void);
+		void	superviseProcesses(void);
+		pid_t	spawnProcess(int slot);
+		void	pinToCpu(int slot) const;
+		void	stopProcesses(void);
+		int		findSlot(pid_t pid) const;
+
+		static void	*runWorker(void *arg);
+		static void	handleStopSignal(int sig);
+
+		WorkerPool(void);
+		WorkerPool(const WorkerPool &obj);
+		WorkerPool &operator=(const WorkerPool &obj);
+};
+
+#endif
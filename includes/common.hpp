@@ -4,9 +4,11 @@
 #include <iostream>
 #include <string>
 #include <cstring>
+#include <strings.h>
 #include <sstream>
 #include <fstream>
 #include <cstdlib>
+#include <cerrno>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <dirent.h>
@@ -20,15 +22,26 @@
 #include <arpa/inet.h>
 #include <poll.h>
 #include <sys/wait.h>
+#include <csignal>
 
 // STL
 #include <map>
+#include <set>
 #include <vector>
 #include <algorithm>
 
 // Static Const Variables
 // static const std::size_t DEFAULT_MAX_BODY_SIZE = 1 * 1024 * 1024; // 1MB
 static const std::size_t DEFAULT_MAX_BODY_SIZE = 200000000;
+static const int DEFAULT_KEEPALIVE_TIMEOUT = 75; // seconds, as in NGINX
+static const std::size_t DEFAULT_KEEPALIVE_REQUESTS = 1000;
+static const int DEFAULT_CLIENT_TIMEOUT = 60; // seconds; header, body and send timeouts, as in NGINX
+static const std::size_t DEFAULT_CLIENT_BODY_BUFFER_SIZE = 16 * 1024; // larger bodies are spooled to disk
+static const int DEFAULT_OPEN_FILE_CACHE_TIME = 60; // seconds; open_file_cache inactive= and open_file_cache_valid, as in NGINX
+static const int DEFAULT_GZIP_COMP_LEVEL = 1; // as in NGINX
+static const std::size_t DEFAULT_GZIP_MIN_LENGTH = 20; // bytes; shorter bodies are sent as they are, as in NGINX
+static const std::size_t DEFAULT_CONTENT_CACHE_MAX_FILE = 64 * 1024; // content_cache max_file=; larger files go out with sendfile()
+static const std::size_t GZIP_CACHE_SIZE = 1024 * 1024; // compressed static responses kept when content_cache is off
 
 // Colours
 #define RESET   "\033[0m"
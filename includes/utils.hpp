@@ -13,5 +13,13 @@ void	errorMsg(const std::string &msg, int fd);
 void	fatalError(const std::string &context);
 std::string httpStatusMessage(int code);
 std::string joinPath(const std::string &base, const std::string &relative);
+int		onlineCpuCount(void);
+unsigned long	monotonicMillis(void);
+int		dupCloexec(int fd);
+int		pipeCloexec(int fds[2]);
+std::string sanitizeFilename(const std::string &filename);
+bool	isSafePath(const std::string &path, const std::string &baseDir);
+std::string httpDate(time_t t);
+bool	parseHttpDate(const std::string &value, time_t &t);
 
 #endif
@@ -1,9 +1,10 @@
 #include "../../includes/ConfigParser.hpp"
 
 // Constructors don't parse (since parse() throws an exception)
-ConfigParser::ConfigParser(void) {}
-ConfigParser::ConfigParser(const std::string &filename): _filename(filename) {}
-ConfigParser::ConfigParser(const ConfigParser &obj): _filename(obj._filename), _servers(obj._servers) {}
+ConfigParser::ConfigParser(void): _workerThreads(1), _workerProcesses(1), _cpuAffinity(false) {}
+ConfigParser::ConfigParser(const std::string &filename): _filename(filename), _workerThreads(1), _workerProcesses(1), _cpuAffinity(false) {}
+ConfigParser::ConfigParser(const ConfigParser &obj): _filename(obj._filename), _servers(obj._servers), _workerThreads(obj._workerThreads), \
+	_workerProcesses(obj._workerProcesses), _cpuAffinity(obj._cpuAffinity) {}
 ConfigParser::~ConfigParser(void) {}
 ConfigParser &ConfigParser::operator=(const ConfigParser &obj)
 {
@@ -11,11 +12,17 @@ ConfigParser &ConfigParser::operator=(const ConfigParser &obj)
 	{
 		_filename = obj._filename;
 		_servers = obj._servers;
+		_workerThreads = obj._workerThreads;
+		_workerProcesses = obj._workerProcesses;
+		_cpuAffinity = obj._cpuAffinity;
 	}
 	return (*this);
 }
 
 const std::vector<ServerConfig> &ConfigParser::getServers(void) const { return _servers; }
+int	ConfigParser::getWorkerThreads(void) const { return _workerThreads; }
+int	ConfigParser::getWorkerProcesses(void) const { return _workerProcesses; }
+bool	ConfigParser::getCpuAffinity(void) const { return _cpuAffinity; }
 
 void	ConfigParser::parse(void)
 {
@@ -29,7 +36,17 @@ void	ConfigParser::parse(void)
 		if (line.empty())
 			continue;
 		if (line == "server {")
+		{
 			parseServerBlock(file);
+			continue;
+		}
+		std::vector<std::string> tokens = tokenize(line);
+		if (tokens[0] == "worker_threads")
+			_workerThreads = parseWorkerCount(tokens);
+		else if (tokens[0] == "worker_processes")
+			_workerProcesses = parseWorkerCount(tokens);
+		else if (tokens[0] == "worker_cpu_affinity")
+			_cpuAffinity = parseCpuAffinity(tokens);
 		else
 			throw std::runtime_error("Expected 'server {' but got : " + line);
 	}
@@ -50,6 +67,31 @@ std::string ConfigParser::cleanLine(const std::string &line)
 	return trimmed;
 }
 
+/// Global directive outside server blocks: a positive count or "auto" (one per online CPU)
+int ConfigParser::parseWorkerCount(const std::vector<std::string> &tokens)
+{
+	if (tokens.size() != 2)
+		throw std::runtime_error("Invalid number of arguments for '" + tokens[0] + "'");
+	if (tokens[1] == "auto")
+		return onlineCpuCount();
+	int count = std::atoi(tokens[1].c_str());
+	if (count <= 0)
+		throw std::runtime_error("'" + tokens[0] + "' must be positive or 'auto'");
+	return count;
+}
+
+/// "auto" pins worker process i to CPU i (modulo the CPU count); "off" leaves scheduling to the kernel
+bool ConfigParser::parseCpuAffinity(const std::vector<std::string> &tokens)
+{
+	if (tokens.size() != 2)
+		throw std::runtime_error("Invalid number of arguments for 'worker_cpu_affinity'");
+	if (tokens[1] == "auto")
+		return true;
+	if (tokens[1] == "off")
+		return false;
+	throw std::runtime_error("Invalid value for 'worker_cpu_affinity': " + tokens[1]);
+}
+
 /// Checks
 /// - server block has opening and closing brace
 /// - location block is started with curly brace on same line or next line
@@ -89,6 +131,26 @@ void	ConfigParser::parseServerBlock(std::istream &in)
 				throw std::runtime_error("Negative value in 'client_max_body_size'");
 			server.setClientMaxBodySize(size);
 		}
+		else if (tokens[0] == "keepalive_timeout")
+			parseKeepaliveTimeout(server, tokens);
+		else if (tokens[0] == "keepalive_requests")
+			parseKeepaliveRequests(server, tokens);
+		else if (tokens[0] == "client_header_timeout")
+			server.setClientHeaderTimeout(parseTimeout(tokens));
+		else if (tokens[0] == "client_body_timeout")
+			server.setClientBodyTimeout(parseTimeout(tokens));
+		else if (tokens[0] == "send_timeout")
+			server.setSendTimeout(parseTimeout(tokens));
+		else if (tokens[0] == "client_body_buffer_size")
+			parseClientBodyBufferSize(server, tokens);
+		else if (tokens[0] == "open_file_cache")
+			parseOpenFileCache(server, tokens);
+		else if (tokens[0] == "open_file_cache_valid")
+			server.setOpenFileCacheValid(parseTimeout(tokens));
+		else if (tokens[0] == "open_file_cache_errors")
+			parseOpenFileCacheErrors(server, tokens);
+		else if (tokens[0] == "content_cache")
+			parseContentCache(server, tokens);
 		else if (tokens[0] == "location")
 			parseLocation(server, in, tokens);
 		else
@@ -153,6 +215,107 @@ void ConfigParser::parseErrorPage(ServerConfig &server, const std::vector<std::s
 	server.addErrorPage(code, tokens[2]);
 }
 
+/// keepalive_timeout 0 disables persistent connections (like in NGINX)
+void ConfigParser::parseKeepaliveTimeout(ServerConfig &server, const std::vector<std::string> &tokens)
+{
+	if (tokens.size() != 2)
+		throw std::runtime_error("Invalid 'keepalive_timeout' directive");
+	int seconds = std::atoi(tokens[1].c_str());
+	if (seconds < 0)
+		throw std::runtime_error("Negative value in 'keepalive_timeout'");
+	server.setKeepaliveTimeout(seconds);
+}
+
+void ConfigParser::parseKeepaliveRequests(ServerConfig &server, const std::vector<std::string> &tokens)
+{
+	if (tokens.size() != 2)
+		throw std::runtime_error("Invalid 'keepalive_requests' directive");
+	int maxRequests = std::atoi(tokens[1].c_str());
+	if (maxRequests <= 0)
+		throw std::runtime_error("'keepalive_requests' must be positive");
+	server.setKeepaliveRequests(maxRequests);
+}
+
+/// client_header_timeout, client_body_timeout and send_timeout take seconds
+int ConfigParser::parseTimeout(const std::vector<std::string> &tokens)
+{
+	if (tokens.size() != 2)
+		throw std::runtime_error("Invalid '" + tokens[0] + "' directive");
+	int seconds = std::atoi(tokens[1].c_str());
+	if (seconds <= 0)
+		throw std::runtime_error("'" + tokens[0] + "' must be positive");
+	return seconds;
+}
+
+/// Request bodies larger than this are spooled to a temp file (like in NGINX)
+void ConfigParser::parseClientBodyBufferSize(ServerConfig &server, const std::vector<std::string> &tokens)
+{
+	if (tokens.size() != 2)
+		throw std::runtime_error("Invalid 'client_body_buffer_size' directive");
+	int size = std::atoi(tokens[1].c_str());
+	if (size < 0)
+		throw std::runtime_error("Negative value in 'client_body_buffer_size'");
+	server.setClientBodyBufferSize(size);
+}
+
+/// open_file_cache off | max=N [inactive=seconds] (like in NGINX)
+void ConfigParser::parseOpenFileCache(ServerConfig &server, const std::vector<std::string> &tokens)
+{
+	if (tokens.size() == 2 && tokens[1] == "off")
+	{
+		server.setOpenFileCache(0, DEFAULT_OPEN_FILE_CACHE_TIME);
+		return;
+	}
+	if (tokens.size() < 2 || tokens.size() > 3 || tokens[1].compare(0, 4, "max=") != 0)
+		throw std::runtime_error("Invalid 'open_file_cache' directive");
+	int maxEntries = std::atoi(tokens[1].c_str() + 4);
+	if (maxEntries <= 0)
+		throw std::runtime_error("'open_file_cache' max must be positive");
+	int inactive = DEFAULT_OPEN_FILE_CACHE_TIME;
+	if (tokens.size() == 3)
+	{
+		if (tokens[2].compare(0, 9, "inactive=") != 0)
+			throw std::runtime_error("Invalid 'open_file_cache' directive");
+		inactive = std::atoi(tokens[2].c_str() + 9);
+		if (inactive <= 0)
+			throw std::runtime_error("'open_file_cache' inactive must be positive");
+	}
+	server.setOpenFileCache(maxEntries, inactive);
+}
+
+void ConfigParser::parseOpenFileCacheErrors(ServerConfig &server, const std::vector<std::string> &tokens)
+{
+	if (tokens.size() != 2 || (tokens[1] != "on" && tokens[1] != "off"))
+		throw std::runtime_error("Invalid 'open_file_cache_errors' directive");
+	server.setOpenFileCacheErrors(tokens[1] == "on");
+}
+
+/// content_cache off | size=bytes [max_file=bytes]
+/// Responses for static files up to max_file bytes are kept rendered in memory
+void ConfigParser::parseContentCache(ServerConfig &server, const std::vector<std::string> &tokens)
+{
+	if (tokens.size() == 2 && tokens[1] == "off")
+	{
+		server.setContentCache(0, DEFAULT_CONTENT_CACHE_MAX_FILE);
+		return;
+	}
+	if (tokens.size() < 2 || tokens.size() > 3 || tokens[1].compare(0, 5, "size=") != 0)
+		throw std::runtime_error("Invalid 'content_cache' directive");
+	int size = std::atoi(tokens[1].c_str() + 5);
+	if (size <= 0)
+		throw std::runtime_error("'content_cache' size must be positive");
+	int maxFile = DEFAULT_CONTENT_CACHE_MAX_FILE;
+	if (tokens.size() == 3)
+	{
+		if (tokens[2].compare(0, 9, "max_file=") != 0)
+			throw std::runtime_error("Invalid 'content_cache' directive");
+		maxFile = std::atoi(tokens[2].c_str() + 9);
+		if (maxFile <= 0)
+			throw std::runtime_error("'content_cache' max_file must be positive");
+	}
+	server.setContentCache(size, maxFile);
+}
+
 void ConfigParser::parseLocation(ServerConfig &server, std::istream &in, const std::vector<std::string> &tokens)
 {
 	if (tokens.size() < 2 || tokens[1][0] != '/')
@@ -210,6 +373,16 @@ void ConfigParser::parseLocationBlock(std::istream &in, Route &route)
 			handleClientMaxBodyDirective(tokens, route);
 		else if (directive == "cgi")
 			handleCGIDirective(tokens, route);
+		else if (directive == "content_cache_status")
+			handleContentCacheStatusDirective(tokens, route);
+		else if (directive == "gzip_static")
+			handleGzipStaticDirective(tokens, route);
+		else if (directive == "gzip" || directive == "gzip_comp_level" || directive == "gzip_min_length" || directive == "gzip_types")
+			handleGzipDirective(tokens, route);
+		else if (directive == "expires")
+			handleExpiresDirective(tokens, route);
+		else if (directive == "add_header")
+			handleAddHeaderDirective(tokens, route);
 		else
 			throw std::runtime_error("Unknown or malformed directive in location block: " + line);
 	}
@@ -302,3 +475,126 @@ void ConfigParser::handleCGIDirective(const std::vector<std::string>& tokens, Ro
 		throw std::runtime_error("Invalid 'cgi' directive");
 	route.addCGI(tokens[1], tokens[2]);
 }
+
+void ConfigParser::handleContentCacheStatusDirective(const std::vector<std::string>& tokens, Route& route)
+{
+	if (tokens.size() != 2 || (tokens[1] != "on" && tokens[1] != "off"))
+		throw std::runtime_error("Invalid 'content_cache_status' directive");
+	route.setCacheStatus(tokens[1] == "on");
+}
+
+void ConfigParser::handleGzipStaticDirective(const std::vector<std::string>& tokens, Route& route)
+{
+	if (tokens.size() != 2 || (tokens[1] != "on" && tokens[1] != "off"))
+		throw std::runtime_error("Invalid 'gzip_static' directive");
+	route.setGzipStatic(tokens[1] == "on");
+}
+
+/// gzip on|off, gzip_comp_level 1-9, gzip_min_length bytes, gzip_types mime... (like in NGINX)
+void ConfigParser::handleGzipDirective(const std::vector<std::string>& tokens, Route& route)
+{
+	if (tokens.size() < 2 || (tokens[0] != "gzip_types" && tokens.size() != 2))
+		throw std::runtime_error("Invalid '" + tokens[0] + "' directive");
+	if (tokens[0] == "gzip")
+	{
+		if (tokens[1] != "on" && tokens[1] != "off")
+			throw std::runtime_error("Invalid 'gzip' directive");
+		route.setGzip(tokens[1] == "on");
+	}
+	else if (tokens[0] == "gzip_comp_level")
+	{
+		int level = std::atoi(tokens[1].c_str());
+		if (level < 1 || level > 9)
+			throw std::runtime_error("'gzip_comp_level' must be between 1 and 9");
+		route.setGzipCompLevel(level);
+	}
+	else if (tokens[0] == "gzip_min_length")
+	{
+		int length = std::atoi(tokens[1].c_str());
+		if (length < 0)
+			throw std::runtime_error("Negative value in 'gzip_min_length'");
+		route.setGzipMinLength(length);
+	}
+	else
+	{
+		for (std::size_t i = 1; i < tokens.size(); ++i)
+			route.addGzipType(tokens[i]);
+	}
+}
+
+/// expires off | epoch | max | [-]time [immutable] (like in NGINX), where time is
+/// a number of seconds or units such as 30d, 12h or 1h30m (s, m, h, d, w, M, y)
+void ConfigParser::handleExpiresDirective(const std::vector<std::string>& tokens, Route& route)
+{
+	bool immutable = (tokens.size() == 3 && tokens[2] == "immutable");
+	if (tokens.size() != 2 && !immutable)
+		throw std::runtime_error("Invalid 'expires' directive");
+	if (tokens[1] == "off" || tokens[1] == "epoch")
+	{
+		if (immutable)
+			throw std::runtime_error("'expires " + tokens[1] + "' cannot be immutable");
+		route.setExpires(tokens[1] == "off" ? EXPIRES_OFF : EXPIRES_EPOCH, 0, false);
+	}
+	else if (tokens[1] == "max")
+		route.setExpires(EXPIRES_MAX, 0, immutable);
+	else
+		route.setExpires(EXPIRES_TIME, parseTimeValue(tokens[1]), immutable);
+}
+
+long ConfigParser::parseTimeValue(const std::string &value)
+{
+	std::size_t i = (!value.empty() && value[0] == '-') ? 1 : 0;
+	if (i == value.size())
+		throw std::runtime_error("Invalid time in 'expires': " + value);
+	long total = 0;
+	while (i < value.size())
+	{
+		if (!std::isdigit(static_cast<unsigned char>(value[i])))
+			throw std::runtime_error("Invalid time in 'expires': " + value);
+		long n = 0;
+		for (; i < value.size() && std::isdigit(static_cast<unsigned char>(value[i])); ++i)
+			n = n * 10 + (value[i] - '0');
+		long unit = 1;
+		if (i < value.size())
+		{
+			switch (value[i++])
+			{
+				case 's': unit = 1; break;
+				case 'm': unit = 60; break;
+				case 'h': unit = 3600; break;
+				case 'd': unit = 86400; break;
+				case 'w': unit = 7 * 86400; break;
+				case 'M': unit = 30 * 86400; break;
+				case 'y': unit = 365 * 86400; break;
+				default: throw std::runtime_error("Invalid time in 'expires': " + value);
+			}
+		}
+		total += n * unit;
+	}
+	return (value[0] == '-') ? -total : total;
+}
+
+/// add_header name value [always] (like in NGINX); a value with spaces is quoted
+void ConfigParser::handleAddHeaderDirective(const std::vector<std::string>& tokens, Route& route)
+{
+	if (tokens.size() < 3)
+		throw std::runtime_error("Invalid 'add_header' directive");
+	AddedHeader header;
+	header.name = tokens[1];
+	std::size_t last = tokens.size();
+	header.always = (tokens.size() > 3 && tokens[last - 1] == "always");
+	if (header.always)
+		--last;
+	for (std::size_t i = 2; i < last; ++i)
+	{
+		if (i > 2)
+			header.value += " ";
+		header.value += tokens[i];
+	}
+	if (header.value.size() >= 2 && (header.value[0] == '"' || header.value[0] == '\'')
+		&& header.value[header.value.size() - 1] == header.value[0])
+		header.value = header.value.substr(1, header.value.size() - 2);
+	if (header.name.find_first_of(":\r\n") != std::string::npos || header.value.find_first_of("\r\n") != std::string::npos)
+		throw std::runtime_error("Invalid 'add_header' directive");
+	route.addHeader(header);
+}
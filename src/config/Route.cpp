@@ -1,10 +1,15 @@
 #include "../../includes/Route.hpp"
 
-Route::Route(void): _autoindex(false), _isRedirect(false), _hasClientMaxBodySize(false) {}
+Route::Route(void): _autoindex(false), _isRedirect(false), _hasClientMaxBodySize(false), _cacheStatus(false), _gzipStatic(false), \
+ _gzip(false), _gzipCompLevel(DEFAULT_GZIP_COMP_LEVEL), _gzipMinLength(DEFAULT_GZIP_MIN_LENGTH), \
+ _expiresPolicy(EXPIRES_OFF), _expiresSeconds(0), _expiresImmutable(false) {}
 Route::Route(const Route &obj): _location(obj._location), _root(obj._root), _methods(obj._methods), \
  _indexFiles(obj._indexFiles), _autoindex(obj._autoindex), _uploadDir(obj._uploadDir), \
  _isRedirect(obj._isRedirect), _redirectStatusCode(obj._redirectStatusCode), _redirectURL(obj._redirectURL), _cgi(obj._cgi), \
- _clientMaxBodySize(obj._clientMaxBodySize), _hasClientMaxBodySize(obj._hasClientMaxBodySize) {}
+ _clientMaxBodySize(obj._clientMaxBodySize), _hasClientMaxBodySize(obj._hasClientMaxBodySize), _cacheStatus(obj._cacheStatus), _gzipStatic(obj._gzipStatic), \
+ _gzip(obj._gzip), _gzipCompLevel(obj._gzipCompLevel), _gzipMinLength(obj._gzipMinLength), _gzipTypes(obj._gzipTypes), \
+ _expiresPolicy(obj._expiresPolicy), _expiresSeconds(obj._expiresSeconds), _expiresImmutable(obj._expiresImmutable), \
+ _addedHeaders(obj._addedHeaders) {}
 Route::~Route(void) {}
 Route &Route::operator=(const Route &obj) 
 {
@@ -22,6 +27,16 @@ Route &Route::operator=(const Route &obj)
 		_cgi = obj._cgi;
 		_clientMaxBodySize = obj._clientMaxBodySize;
 		_hasClientMaxBodySize = obj._hasClientMaxBodySize;
+		_cacheStatus = obj._cacheStatus;
+		_gzipStatic = obj._gzipStatic;
+		_gzip = obj._gzip;
+		_gzipCompLevel = obj._gzipCompLevel;
+		_gzipMinLength = obj._gzipMinLength;
+		_gzipTypes = obj._gzipTypes;
+		_expiresPolicy = obj._expiresPolicy;
+		_expiresSeconds = obj._expiresSeconds;
+		_expiresImmutable = obj._expiresImmutable;
+		_addedHeaders = obj._addedHeaders;
 	}
 	return (*this);
 }
@@ -56,6 +71,19 @@ void	Route::setClientMaxBodySize(std::size_t clientMaxBodySize)
 	_clientMaxBodySize = clientMaxBodySize; 
 	_hasClientMaxBodySize = true;
 }
+void	Route::setCacheStatus(bool cacheStatus) { _cacheStatus = cacheStatus; }
+void	Route::setGzipStatic(bool gzipStatic) { _gzipStatic = gzipStatic; }
+void	Route::setGzip(bool gzip) { _gzip = gzip; }
+void	Route::setGzipCompLevel(int level) { _gzipCompLevel = level; }
+void	Route::setGzipMinLength(std::size_t length) { _gzipMinLength = length; }
+void	Route::addGzipType(const std::string &type) { _gzipTypes.push_back(toLower(type)); }
+void	Route::setExpires(ExpiresPolicy policy, long seconds, bool immutable)
+{
+	_expiresPolicy = policy;
+	_expiresSeconds = seconds;
+	_expiresImmutable = immutable;
+}
+void	Route::addHeader(const AddedHeader &header) { _addedHeaders.push_back(header); }
 
 const std::string &Route::getLocation(void) const { return _location; }
 const std::string &Route::getRoot(void) const { return _root; }
@@ -69,6 +97,16 @@ const std::string &Route::getRedirectURL(void) const { return _redirectURL; }
 const std::map<std::string, std::string> &Route::getCGI(void) const { return _cgi; }
 std::size_t Route::getClientMaxBodySize(void) const { return _clientMaxBodySize; }
 bool Route::hasClientMaxBodySize(void) const { return _hasClientMaxBodySize; }
+bool Route::isCacheStatus(void) const { return _cacheStatus; }
+bool Route::getGzipStatic(void) const { return _gzipStatic; }
+bool Route::getGzip(void) const { return _gzip; }
+int Route::getGzipCompLevel(void) const { return _gzipCompLevel; }
+std::size_t Route::getGzipMinLength(void) const { return _gzipMinLength; }
+const std::vector<std::string> &Route::getGzipTypes(void) const { return _gzipTypes; }
+ExpiresPolicy Route::getExpiresPolicy(void) const { return _expiresPolicy; }
+long Route::getExpiresSeconds(void) const { return _expiresSeconds; }
+bool Route::isExpiresImmutable(void) const { return _expiresImmutable; }
+const std::vector<AddedHeader> &Route::getAddedHeaders(void) const { return _addedHeaders; }
 
 bool Route::isMethodAllowed(const std::string &method) const {
 	const std::vector<std::string> &allowed = getMethods();
@@ -1,7 +1,16 @@
 #include "../../includes/ServerConfig.hpp"
 
-ServerConfig::ServerConfig(void): _hasClientMaxBodySize(false) {}
-ServerConfig::ServerConfig(const ServerConfig &obj): _host(obj._host), _port(obj._port), _serverNames(obj._serverNames), _errorPages(obj._errorPages), _routes(obj._routes), _clientMaxBodySize(obj._clientMaxBodySize), _hasClientMaxBodySize(obj._hasClientMaxBodySize) {}
+ServerConfig::ServerConfig(void): _hasClientMaxBodySize(false), _keepaliveTimeout(DEFAULT_KEEPALIVE_TIMEOUT), _keepaliveRequests(DEFAULT_KEEPALIVE_REQUESTS), \
+	_clientHeaderTimeout(DEFAULT_CLIENT_TIMEOUT), _clientBodyTimeout(DEFAULT_CLIENT_TIMEOUT), _sendTimeout(DEFAULT_CLIENT_TIMEOUT), \
+	_clientBodyBufferSize(DEFAULT_CLIENT_BODY_BUFFER_SIZE), _openFileCacheMax(0), \
+	_openFileCacheInactive(DEFAULT_OPEN_FILE_CACHE_TIME), _openFileCacheValid(DEFAULT_OPEN_FILE_CACHE_TIME), _openFileCacheErrors(false), \
+	_contentCacheSize(0), _contentCacheMaxFile(DEFAULT_CONTENT_CACHE_MAX_FILE) {}
+ServerConfig::ServerConfig(const ServerConfig &obj): _host(obj._host), _port(obj._port), _serverNames(obj._serverNames), _errorPages(obj._errorPages), _routes(obj._routes), _clientMaxBodySize(obj._clientMaxBodySize), _hasClientMaxBodySize(obj._hasClientMaxBodySize), \
+	_keepaliveTimeout(obj._keepaliveTimeout), _keepaliveRequests(obj._keepaliveRequests), \
+	_clientHeaderTimeout(obj._clientHeaderTimeout), _clientBodyTimeout(obj._clientBodyTimeout), _sendTimeout(obj._sendTimeout), \
+	_clientBodyBufferSize(obj._clientBodyBufferSize), _openFileCacheMax(obj._openFileCacheMax), \
+	_openFileCacheInactive(obj._openFileCacheInactive), _openFileCacheValid(obj._openFileCacheValid), _openFileCacheErrors(obj._openFileCacheErrors), \
+	_contentCacheSize(obj._contentCacheSize), _contentCacheMaxFile(obj._contentCacheMaxFile) {}
 ServerConfig::~ServerConfig(void) {}
 ServerConfig &ServerConfig::operator=(const ServerConfig &obj)
 {
@@ -14,6 +23,18 @@ ServerConfig &ServerConfig::operator=(const ServerConfig &obj)
 		_routes = obj._routes;
 		_clientMaxBodySize = obj._clientMaxBodySize;
 		_hasClientMaxBodySize = obj._hasClientMaxBodySize;
+		_keepaliveTimeout = obj._keepaliveTimeout;
+		_keepaliveRequests = obj._keepaliveRequests;
+		_clientHeaderTimeout = obj._clientHeaderTimeout;
+		_clientBodyTimeout = obj._clientBodyTimeout;
+		_sendTimeout = obj._sendTimeout;
+		_clientBodyBufferSize = obj._clientBodyBufferSize;
+		_openFileCacheMax = obj._openFileCacheMax;
+		_openFileCacheInactive = obj._openFileCacheInactive;
+		_openFileCacheValid = obj._openFileCacheValid;
+		_openFileCacheErrors = obj._openFileCacheErrors;
+		_contentCacheSize = obj._contentCacheSize;
+		_contentCacheMaxFile = obj._contentCacheMaxFile;
 	}
 	return (*this);
 }
@@ -28,6 +49,24 @@ void	ServerConfig::setClientMaxBodySize(std::size_t clientMaxBodySize)
 	_clientMaxBodySize = clientMaxBodySize; 
 	_hasClientMaxBodySize = true;
 }
+void	ServerConfig::setKeepaliveTimeout(int seconds) { _keepaliveTimeout = seconds; }
+void	ServerConfig::setKeepaliveRequests(std::size_t maxRequests) { _keepaliveRequests = maxRequests; }
+void	ServerConfig::setClientHeaderTimeout(int seconds) { _clientHeaderTimeout = seconds; }
+void	ServerConfig::setClientBodyTimeout(int seconds) { _clientBodyTimeout = seconds; }
+void	ServerConfig::setSendTimeout(int seconds) { _sendTimeout = seconds; }
+void	ServerConfig::setClientBodyBufferSize(std::size_t size) { _clientBodyBufferSize = size; }
+void	ServerConfig::setOpenFileCache(std::size_t maxEntries, int inactive)
+{
+	_openFileCacheMax = maxEntries;
+	_openFileCacheInactive = inactive;
+}
+void	ServerConfig::setOpenFileCacheValid(int seconds) { _openFileCacheValid = seconds; }
+void	ServerConfig::setOpenFileCacheErrors(bool enabled) { _openFileCacheErrors = enabled; }
+void	ServerConfig::setContentCache(std::size_t size, std::size_t maxFileSize)
+{
+	_contentCacheSize = size;
+	_contentCacheMaxFile = maxFileSize;
+}
 
 const std::string &ServerConfig::getHost(void) const { return _host; }
 int	ServerConfig::getPort(void) const { return _port; }
@@ -36,6 +75,18 @@ const std::vector<Route> &ServerConfig::getRoutes(void) const { return _routes;
 const std::map<int, std::string> &ServerConfig::getErrorPages(void) const { return _errorPages; }
 std::size_t ServerConfig::getClientMaxBodySize(void) const { return _clientMaxBodySize; }
 bool ServerConfig::hasClientMaxBodySize(void) const { return _hasClientMaxBodySize; }
+int ServerConfig::getKeepaliveTimeout(void) const { return _keepaliveTimeout; }
+std::size_t ServerConfig::getKeepaliveRequests(void) const { return _keepaliveRequests; }
+int ServerConfig::getClientHeaderTimeout(void) const { return _clientHeaderTimeout; }
+int ServerConfig::getClientBodyTimeout(void) const { return _clientBodyTimeout; }
+int ServerConfig::getSendTimeout(void) const { return _sendTimeout; }
+std::size_t ServerConfig::getClientBodyBufferSize(void) const { return _clientBodyBufferSize; }
+std::size_t ServerConfig::getOpenFileCacheMax(void) const { return _openFileCacheMax; }
+int ServerConfig::getOpenFileCacheInactive(void) const { return _openFileCacheInactive; }
+int ServerConfig::getOpenFileCacheValid(void) const { return _openFileCacheValid; }
+bool ServerConfig::getOpenFileCacheErrors(void) const { return _openFileCacheErrors; }
+std::size_t ServerConfig::getContentCacheSize(void) const { return _contentCacheSize; }
+std::size_t ServerConfig::getContentCacheMaxFile(void) const { return _contentCacheMaxFile; }
 
 
 bool ServerConfig::matchRoute(const std::string &target, Route &matchedRoute) const
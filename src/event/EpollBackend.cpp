@@ -0,0 +1,90 @@
+#include "../../includes/EpollBackend.hpp"
+
+#ifdef __linux__
+
+EpollBackend::EpollBackend(void): _epollFD(-1), _events(1024)
+{
+	_epollFD = epoll_create1(EPOLL_CLOEXEC);
+	if (_epollFD < 0)
+		throw std::runtime_error("epoll_create1 failed");
+}
+
+EpollBackend::~EpollBackend(void)
+{
+	if (_epollFD != -1)
+		close(_epollFD);
+}
+
+bool EpollBackend::add(int fd, int events, void *data)
+{
+	return control(EPOLL_CTL_ADD, fd, events, data);
+}
+
+bool EpollBackend::modify(int fd, int events, void *data)
+{
+	return control(EPOLL_CTL_MOD, fd, events, data);
+}
+
+void EpollBackend::remove(int fd)
+{
+	// Closing an fd removes it from the epoll set anyway; this keeps dup()ed fds honest
+	epoll_ctl(_epollFD, EPOLL_CTL_DEL, fd, NULL);
+	if (fd >= 0 && static_cast<std::size_t>(fd) < _userData.size())
+		_userData[fd] = NULL;
+}
+
+// Every registration is edge-triggered; EPOLLRDHUP lets a half-closed peer
+// surface as a read event so it is noticed without an extra wakeup
+bool EpollBackend::control(int op, int fd, int events, void *data)
+{
+	if (fd < 0)
+		return false;
+	struct epoll_event ev;
+	std::memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLET | EPOLLRDHUP;
+	if (events & EVENT_READ)
+		ev.events |= EPOLLIN;
+	if (events & EVENT_WRITE)
+		ev.events |= EPOLLOUT;
+	ev.data.fd = fd;
+	if (epoll_ctl(_epollFD, op, fd, &ev) < 0)
+		return false;
+	if (static_cast<std::size_t>(fd) >= _userData.size())
+		_userData.resize(fd + 1, NULL);
+	_userData[fd] = data;
+	return true;
+}
+
+int EpollBackend::wait(std::vector<Event> &ready, int timeoutMs)
+{
+	ready.clear();
+	int n = epoll_wait(_epollFD, &_events[0], static_cast<int>(_events.size()), timeoutMs);
+	if (n < 0)
+	{
+		if (errno == EINTR)
+			return 0;
+		return -1;
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		Event ev;
+		ev.fd = _events[i].data.fd;
+		ev.events = 0;
+		if (_events[i].events & (EPOLLIN | EPOLLRDHUP))
+			ev.events |= EVENT_READ;
+		if (_events[i].events & EPOLLOUT)
+			ev.events |= EVENT_WRITE;
+		if (_events[i].events & (EPOLLERR | EPOLLHUP))
+			ev.events |= EVENT_ERROR;
+		ev.data = (static_cast<std::size_t>(ev.fd) < _userData.size()) ? _userData[ev.fd] : NULL;
+		ready.push_back(ev);
+	}
+	// A full batch means more fds are probably ready; grow so the next wait drains them in one call
+	if (static_cast<std::size_t>(n) == _events.size())
+		_events.resize(_events.size() * 2);
+	return n;
+}
+
+const char *EpollBackend::getName(void) const { return "epoll"; }
+
+#endif
@@ -0,0 +1,20 @@
+#include "../../includes/IEventBackend.hpp"
+#include "../../includes/EpollBackend.hpp"
+#include "../../includes/SelectBackend.hpp"
+
+// Prefers epoll where available; falls back to select() when built with
+// -DWEBSERV_USE_SELECT, on non-Linux systems, or if epoll cannot be created
+IEventBackend *createEventBackend(void)
+{
+#if defined(__linux__) && !defined(WEBSERV_USE_SELECT)
+	try
+	{
+		return new EpollBackend();
+	}
+	catch (const std::exception &e)
+	{
+		errorMsg(std::string(e.what()) + "; falling back to select()");
+	}
+#endif
+	return new SelectBackend();
+}
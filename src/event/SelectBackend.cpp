@@ -0,0 +1,95 @@
+#include "../../includes/SelectBackend.hpp"
+
+SelectBackend::SelectBackend(void): _maxFd(-1)
+{
+	FD_ZERO(&_masterReadFds);
+	FD_ZERO(&_masterWriteFds);
+}
+
+SelectBackend::~SelectBackend(void) {}
+
+// fd_set cannot represent fds at or above FD_SETSIZE; the caller must shed those connections
+bool SelectBackend::add(int fd, int events, void *data)
+{
+	if (fd < 0 || fd >= FD_SETSIZE)
+		return false;
+	return modify(fd, events, data);
+}
+
+bool SelectBackend::modify(int fd, int events, void *data)
+{
+	if (fd < 0 || fd >= FD_SETSIZE)
+		return false;
+	if (events & EVENT_READ)
+		FD_SET(fd, &_masterReadFds);
+	else
+		FD_CLR(fd, &_masterReadFds);
+	if (events & EVENT_WRITE)
+		FD_SET(fd, &_masterWriteFds);
+	else
+		FD_CLR(fd, &_masterWriteFds);
+	if (static_cast<std::size_t>(fd) >= _userData.size())
+		_userData.resize(fd + 1, NULL);
+	_userData[fd] = data;
+	if (fd > _maxFd)
+		_maxFd = fd;
+	return true;
+}
+
+void SelectBackend::remove(int fd)
+{
+	if (fd < 0 || fd >= FD_SETSIZE)
+		return;
+	FD_CLR(fd, &_masterReadFds);
+	FD_CLR(fd, &_masterWriteFds);
+	if (static_cast<std::size_t>(fd) < _userData.size())
+		_userData[fd] = NULL;
+	if (fd == _maxFd)
+		updateMaxFd();
+}
+
+int SelectBackend::wait(std::vector<Event> &ready, int timeoutMs)
+{
+	ready.clear();
+	fd_set readFds = _masterReadFds;
+	fd_set writeFds = _masterWriteFds;
+	struct timeval tv;
+	struct timeval *tvp = NULL;
+	if (timeoutMs >= 0)
+	{
+		tv.tv_sec = timeoutMs / 1000;
+		tv.tv_usec = (timeoutMs % 1000) * 1000;
+		tvp = &tv;
+	}
+
+	int n = select(_maxFd + 1, &readFds, &writeFds, NULL, tvp);
+	if (n < 0)
+	{
+		if (errno == EINTR)
+			return 0;
+		return -1;
+	}
+	for (int fd = 0; fd <= _maxFd && static_cast<int>(ready.size()) < n; ++fd)
+	{
+		Event ev;
+		ev.fd = fd;
+		ev.events = 0;
+		if (FD_ISSET(fd, &readFds))
+			ev.events |= EVENT_READ;
+		if (FD_ISSET(fd, &writeFds))
+			ev.events |= EVENT_WRITE;
+		if (!ev.events)
+			continue;
+		ev.data = _userData[fd];
+		ready.push_back(ev);
+	}
+	return static_cast<int>(ready.size());
+}
+
+const char *SelectBackend::getName(void) const { return "select"; }
+
+void SelectBackend::updateMaxFd(void)
+{
+	while (_maxFd >= 0 && !FD_ISSET(_maxFd, &_masterReadFds) && !FD_ISSET(_maxFd, &_masterWriteFds))
+		--_maxFd;
+}
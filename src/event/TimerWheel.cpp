@@ -0,0 +1,152 @@
+#include "../../includes/TimerWheel.hpp"
+
+TimerWheel::Timer::Timer(void): prev(NULL), next(NULL), expires(0), fd(-1), kind(0) {}
+
+TimerWheel::TimerWheel(unsigned long tickMs, unsigned long nowMs)
+	: _tickMs(tickMs ? tickMs : 1), _currentTick(nowMs / (tickMs ? tickMs : 1)), _count(0)
+{
+	for (int i = 0; i < ROOT_SIZE; ++i)
+		_root[i].prev = _root[i].next = &_root[i];
+	for (int level = 0; level < OUTER_LEVELS; ++level)
+		for (int i = 0; i < LEVEL_SIZE; ++i)
+			_outer[level][i].prev = _outer[level][i].next = &_outer[level][i];
+}
+
+// Detaches whatever is still scheduled so owners never see dangling links
+TimerWheel::~TimerWheel(void)
+{
+	for (int i = 0; i < ROOT_SIZE; ++i)
+		while (_root[i].next != &_root[i])
+			unlink(*_root[i].next);
+	for (int level = 0; level < OUTER_LEVELS; ++level)
+		for (int i = 0; i < LEVEL_SIZE; ++i)
+			while (_outer[level][i].next != &_outer[level][i])
+				unlink(*_outer[level][i].next);
+}
+
+// Rounds the deadline up to a tick boundary, so a timer never fires early
+void TimerWheel::schedule(Timer &timer, unsigned long delayMs, unsigned long nowMs)
+{
+	if (isScheduled(timer))
+		cancel(timer);
+	timer.expires = (nowMs + delayMs + _tickMs - 1) / _tickMs;
+	if (timer.expires < _currentTick)
+		timer.expires = _currentTick;
+	insert(timer);
+	++_count;
+}
+
+void TimerWheel::cancel(Timer &timer)
+{
+	if (!isScheduled(timer))
+		return;
+	unlink(timer);
+	--_count;
+}
+
+bool TimerWheel::isScheduled(const Timer &timer) const { return timer.next != NULL; }
+
+std::size_t TimerWheel::size(void) const { return _count; }
+
+// Processes every tick up to now; timers due on a tick are moved to expired
+// When the root wheel wraps, the next slot of each outer wheel is cascaded
+// inwards (only as far as needed)
+void TimerWheel::advance(unsigned long nowMs, std::vector<Timer*> &expired)
+{
+	unsigned long nowTick = nowMs / _tickMs;
+	if (_count == 0)
+	{
+		if (nowTick >= _currentTick)
+			_currentTick = nowTick + 1;
+		return;
+	}
+	while (_currentTick <= nowTick)
+	{
+		int index = static_cast<int>(_currentTick & ROOT_MASK);
+		if (index == 0)
+		{
+			for (int level = 0; level < OUTER_LEVELS && cascade(level); ++level)
+				;
+		}
+		Timer &head = _root[index];
+		while (head.next != &head)
+		{
+			Timer *timer = head.next;
+			unlink(*timer);
+			--_count;
+			expired.push_back(timer);
+		}
+		++_currentTick;
+	}
+}
+
+// Milliseconds until the event loop must call advance(); -1 when nothing is scheduled
+// Outer timers cannot fire before the root wheel wraps, so the scan stops there
+int TimerWheel::nextTimeout(unsigned long nowMs) const
+{
+	if (_count == 0)
+		return -1;
+	unsigned long tick = _currentTick;
+	for (int k = 0; k < ROOT_SIZE; ++k, ++tick)
+	{
+		if ((tick & ROOT_MASK) == 0 || _root[tick & ROOT_MASK].next != &_root[tick & ROOT_MASK])
+			break;
+	}
+	unsigned long dueMs = tick * _tickMs;
+	return (dueMs > nowMs) ? static_cast<int>(dueMs - nowMs) : 0;
+}
+
+void TimerWheel::insert(Timer &timer)
+{
+	unsigned long delta = timer.expires - _currentTick;
+	if (delta < static_cast<unsigned long>(ROOT_SIZE))
+	{
+		link(_root[timer.expires & ROOT_MASK], timer);
+		return;
+	}
+	for (int level = 0; level < OUTER_LEVELS; ++level)
+	{
+		int shift = ROOT_BITS + (level + 1) * LEVEL_BITS;
+		if (delta < (1UL << shift) || level == OUTER_LEVELS - 1)
+		{
+			// Beyond the outermost wheel's span: park at its far end
+			if (delta >= (1UL << shift))
+				timer.expires = _currentTick + (1UL << shift) - 1;
+			int index = static_cast<int>((timer.expires >> (shift - LEVEL_BITS)) & LEVEL_MASK);
+			link(_outer[level][index], timer);
+			return;
+		}
+	}
+}
+
+// Re-inserts the timers of the current slot of an outer wheel
+// Returns true when that wheel wrapped too, so the next one must cascade as well
+bool TimerWheel::cascade(int level)
+{
+	int shift = ROOT_BITS + level * LEVEL_BITS;
+	int index = static_cast<int>((_currentTick >> shift) & LEVEL_MASK);
+	Timer &head = _outer[level][index];
+	while (head.next != &head)
+	{
+		Timer *timer = head.next;
+		unlink(*timer);
+		insert(*timer);
+	}
+	return index == 0;
+}
+
+void TimerWheel::link(Timer &head, Timer &timer)
+{
+	timer.prev = head.prev;
+	timer.next = &head;
+	head.prev->next = &timer;
+	head.prev = &timer;
+}
+
+void TimerWheel::unlink(Timer &timer)
+{
+	timer.prev->next = timer.next;
+	timer.next->prev = timer.prev;
+	timer.prev = NULL;
+	timer.next = NULL;
+}
@@ -0,0 +1,27 @@
+#include "../../includes/CacheStatusHandler.hpp"
+
+CacheStatusHandler::CacheStatusHandler(const ServerConfig &config, const FileCaches &caches) : _config(config), _caches(caches) {}
+
+CacheStatusHandler::~CacheStatusHandler(void) {}
+
+void CacheStatusHandler::handle(const Request &req, Response &res)
+{
+	(void)req;
+	std::ostringstream body;
+	const ContentCache *cache = _caches.content;
+	if (!cache)
+		body << "content_cache off\n";
+	else
+	{
+		body << "content_cache size=" << _config.getContentCacheSize()
+			<< " max_file=" << cache->getMaxFileSize() << "\n";
+		body << "entries " << cache->getEntryCount() << "\n";
+		body << "bytes " << cache->getSize() << "\n";
+		body << "hits " << cache->getHits() << "\n";
+		body << "misses " << cache->getMisses() << "\n";
+	}
+	res.setStatus(200);
+	res.setHeader("Content-Type", "text/plain");
+	res.setHeader("Cache-Control", "no-store");
+	res.setBody(body.str());
+}
@@ -44,7 +44,7 @@ std::map<std::string, std::string> CgiHandler::getCgiEnv(const Request &req) con
 	std::map<std::string, std::string> env;
 
 	env["AUTH_TYPE"] = "";
-	env["CONTENT_LENGTH"] = toString(req.getBody().length());
+	env["CONTENT_LENGTH"] = toString(req.getBodySize());
 	env["CONTENT_TYPE"] = req.getHeader("content-type");
 	env["GATEWAY_INTERFACE"] = "CGI/1.1";
 	env["PATH_INFO"] = req.getTarget();
@@ -71,8 +71,14 @@ std::string CgiHandler::executeCgi(const Request &req, Response &res, const std:
 	char **env = createEnvArray(envMap);
 
 	int pipe_in[2], pipe_out[2];
-	if (pipe(pipe_in) == -1 || pipe(pipe_out) == -1)
+	if (pipeCloexec(pipe_in) == -1)
 		throw std::runtime_error("pipe failed");
+	if (pipeCloexec(pipe_out) == -1)
+	{
+		close(pipe_in[0]);
+		close(pipe_in[1]);
+		throw std::runtime_error("pipe failed");
+	}
 
 	pid_t pid = fork();
 	if (pid == -1)
@@ -88,14 +94,8 @@ std::string CgiHandler::executeCgi(const Request &req, Response &res, const std:
 		close(pipe_in[0]);
 		close(pipe_out[1]);
 
-		if (!writeRequestBody(req, pipe_in[1]))
-		{
-			waitpid(pid, NULL, 0);
-			res.setError(500, _config);
-			return "";
-		}
-
-		std::string cgiOutput = readCgiOutput(pipe_out[0]);
+		std::string cgiOutput;
+		bool exchanged = exchangeWithCgi(req, pipe_in[1], pipe_out[0], cgiOutput);
 		int status;
 		waitpid(pid, &status, 0);
 		int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
@@ -104,6 +104,12 @@ std::string CgiHandler::executeCgi(const Request &req, Response &res, const std:
 		for (int j = 0; env[j]; ++j)
 			delete[] env[j];
 		delete[] env;
+
+		if (!exchanged)
+		{
+			res.setError(500, _config);
+			return "";
+		}
 		
 		if (exitCode == 126) {
 			debugMsg("CGI exited with 126 — permission denied");
@@ -176,58 +182,96 @@ void CgiHandler::handleChildProcess(const Request &req, const std::string &scrip
 	_exit(1);
 }
 
-bool CgiHandler::writeRequestBody(const Request &req, int writeFd) const
+// The body is streamed to the script's stdin in pieces, wherever it is stored
+// Feeds the request body to the script's stdin while collecting its stdout:
+// poll() waits on both pipes, so a script that writes more than a pipe buffer
+// before it has read all its input cannot deadlock with the server
+// A script that exits or closes stdin early just does not get the rest of the body
+// Closes both descriptors; false when the body or the output could not be read
+bool CgiHandler::exchangeWithCgi(const Request &req, int writeFd, int readFd, std::string &output) const
 {
-	const std::string& body = req.getBody();
-	if (body.empty()) {
-		close(writeFd);
-		return true;
-	}
-
-	ssize_t bytesWritten = write(writeFd, body.c_str(), body.length());
-
+	BodyReader reader(req.getBody());
+	char input[65536];
+	std::size_t inputLength = 0;
+	std::size_t inputOffset = 0;
+	char buffer[65536];
 	bool success = true;
-	if (bytesWritten == -1)
-	{
-		perror("write to CGI stdin failed");
-		success = false;
-	}
-	else if (bytesWritten == 0)
-	{
-		std::cerr << "[error] write() returned 0 — pipe closed?" << std::endl;
-		success = false;
-	}
-	else if (static_cast<size_t>(bytesWritten) < body.length())
-	{
-		std::cerr << "[warning] Partial write to CGI stdin: "
-		          << bytesWritten << "/" << body.length() << " bytes written" << std::endl;
-		success = false;
-	}
-
-	close(writeFd);
-	return success;
-}
-
-std::string CgiHandler::readCgiOutput(int readFd) const
-{
-	std::string output;
-	char buffer[4096];
-	ssize_t bytesRead;
 
-	while ((bytesRead = read(readFd, buffer, sizeof(buffer))) > 0)
+	if (reader.remaining() == 0)
 	{
-		output.append(buffer, bytesRead);
+		close(writeFd);
+		writeFd = -1;
 	}
-	if (bytesRead == -1)
+	else
+		fcntl(writeFd, F_SETFL, O_NONBLOCK);
+	while (readFd != -1)
 	{
-		perror("read from CGI stdout failed");
-		output.clear();
+		struct pollfd fds[2];
+		fds[0].fd = readFd;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		fds[1].fd = writeFd; // ignored by poll() once closed (-1)
+		fds[1].events = POLLOUT;
+		fds[1].revents = 0;
+		if (poll(fds, 2, -1) == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			perror("poll on CGI pipes failed");
+			success = false;
+			break;
+		}
+		if (fds[1].revents)
+		{
+			if (inputOffset == inputLength)
+			{
+				ssize_t bytesRead = reader.read(input, sizeof(input));
+				if (bytesRead <= 0)
+				{
+					perror("read of request body failed");
+					success = false;
+					break;
+				}
+				inputLength = bytesRead;
+				inputOffset = 0;
+			}
+			ssize_t bytesWritten = write(writeFd, input + inputOffset, inputLength - inputOffset);
+			if (bytesWritten > 0)
+				inputOffset += bytesWritten;
+			if ((bytesWritten > 0 && inputOffset == inputLength && reader.remaining() == 0)
+				|| (bytesWritten == -1 && errno != EINTR && errno != EAGAIN))
+			{
+				close(writeFd); // all written, or the script stopped reading (EPIPE)
+				writeFd = -1;
+			}
+		}
+		if (fds[0].revents)
+		{
+			ssize_t bytesRead = read(readFd, buffer, sizeof(buffer));
+			if (bytesRead > 0)
+				output.append(buffer, bytesRead);
+			else if (bytesRead == 0)
+			{
+				close(readFd);
+				readFd = -1;
+			}
+			else if (errno != EINTR)
+			{
+				perror("read from CGI stdout failed");
+				success = false;
+				break;
+			}
+		}
 	}
-	close(readFd);
-	return output;
+	if (writeFd != -1)
+		close(writeFd);
+	if (readFd != -1)
+		close(readFd);
+	if (!success)
+		output.clear();
+	return success;
 }
 
-
 void CgiHandler::parseCgiResponse(const std::string &cgiOutput, Response &res) const
 {
 	std::string::size_type headerEnd = cgiOutput.find("\r\n\r\n");
@@ -284,6 +328,6 @@ void CgiHandler::parseCgiResponse(const std::string &cgiOutput, Response &res) c
 			res.setHeader(key, value);
 	}
 
-	res.setStatusLine(statusCode, httpStatusMessage(statusCode));
+	res.setStatus(statusCode);
 	res.setBody(body);
 }
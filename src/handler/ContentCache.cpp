@@ -0,0 +1,81 @@
+#include "../../includes/ContentCache.hpp"
+
+ContentCache::ContentCache(std::size_t maxSize, std::size_t maxFileSize)
+	: _maxSize(maxSize), _maxFileSize(maxFileSize), _size(0), _hits(0), _misses(0) {}
+
+ContentCache::~ContentCache(void)
+{
+	while (!_entries.empty())
+		erase(_entries.begin());
+}
+
+// Largest file whose response is cached
+std::size_t ContentCache::getMaxFileSize(void) const { return _maxFileSize; }
+
+std::size_t ContentCache::getSize(void) const { return _size; }
+
+std::size_t ContentCache::getEntryCount(void) const { return _entries.size(); }
+
+unsigned long ContentCache::getHits(void) const { return _hits; }
+
+unsigned long ContentCache::getMisses(void) const { return _misses; }
+
+// The response rendered for key, or NULL when there is none or file has changed
+// since it was rendered; the entry stays valid until the next insert() or remove()
+const CachedContent *ContentCache::find(const std::string &key, const OpenFile &file)
+{
+	std::map<std::string, Entry>::iterator it = _entries.find(key);
+	if (it != _entries.end())
+	{
+		const CachedContent &content = it->second.content;
+		if (content.mtime == file.mtime && content.inode == file.inode && content.size == file.size)
+		{
+			++_hits;
+			_lru.splice(_lru.begin(), _lru, it->second.lru);
+			return &content;
+		}
+		erase(it);
+	}
+	++_misses;
+	return NULL;
+}
+
+// Caches the response rendered from file, header first; rendered is left empty
+// Returns the cached copy, or NULL when it does not fit in the cache
+const CachedContent *ContentCache::insert(const std::string &key, const OpenFile &file,
+	std::string &rendered, std::size_t headerLength)
+{
+	remove(key);
+	if (rendered.size() > _maxSize)
+		return NULL;
+	while (_size + rendered.size() > _maxSize)
+		erase(_entries.find(_lru.back()));
+
+	Entry &entry = _entries[key];
+	entry.content.rendered = SharedBuffer::create(rendered);
+	entry.content.headerLength = headerLength;
+	entry.content.mtime = file.mtime;
+	entry.content.inode = file.inode;
+	entry.content.size = file.size;
+	_size += entry.content.rendered->size();
+	_lru.push_front(key);
+	entry.lru = _lru.begin();
+	return &entry.content;
+}
+
+// Forgets key, e.g. once its file has been deleted
+void ContentCache::remove(const std::string &key)
+{
+	std::map<std::string, Entry>::iterator it = _entries.find(key);
+	if (it != _entries.end())
+		erase(it);
+}
+
+// Connections still sending the response keep their own reference to it
+void ContentCache::erase(std::map<std::string, Entry>::iterator it)
+{
+	_size -= it->second.content.rendered->size();
+	it->second.content.rendered->release();
+	_lru.erase(it->second.lru);
+	_entries.erase(it);
+}
@@ -42,7 +42,7 @@ void FormHandler::handle(const Request& req, Response& res)
 
 	html << "</body></html>";
 
-	res.setStatusLine(200, "OK");
+	res.setStatus(200);
 	res.setHeader("Content-Type", "text/html");
 	res.setBody(html.str());
 }
@@ -0,0 +1,81 @@
+#include "../../includes/OpenFileCache.hpp"
+
+OpenFileCache::OpenFileCache(std::size_t maxEntries, int inactive, int valid, bool cacheErrors)
+	: _maxEntries(maxEntries), _inactiveMs(static_cast<unsigned long>(inactive) * 1000),
+	  _validMs(static_cast<unsigned long>(valid) * 1000), _cacheErrors(cacheErrors) {}
+
+OpenFileCache::~OpenFileCache(void)
+{
+	while (!_entries.empty())
+		erase(_entries.begin());
+}
+
+bool OpenFileCache::cachesErrors(void) const { return _cacheErrors; }
+
+// The entry for key, or NULL when there is none or it is no longer valid
+// The entry stays valid until the next insert() or remove()
+const OpenFile *OpenFileCache::find(const std::string &key)
+{
+	std::map<std::string, Entry>::iterator it = _entries.find(key);
+	if (it == _entries.end())
+		return NULL;
+	unsigned long now = monotonicMillis();
+	if (now - it->second.checkedAt >= _validMs)
+	{
+		erase(it);
+		return NULL;
+	}
+	it->second.usedAt = now;
+	_lru.splice(_lru.begin(), _lru, it->second.lru);
+	return &it->second.file;
+}
+
+// Caches the result of a lookup, taking over its descriptor; failed lookups are
+// only kept with open_file_cache_errors on
+// Returns the cached copy, or NULL when it was not cached
+const OpenFile *OpenFileCache::insert(const std::string &key, const OpenFile &file)
+{
+	if (file.status != 0 && !_cacheErrors)
+		return NULL;
+	remove(key);
+	unsigned long now = monotonicMillis();
+	expire(now);
+	if (_entries.size() >= _maxEntries)
+		erase(_entries.find(_lru.back()));
+
+	Entry &entry = _entries[key];
+	entry.file = file;
+	entry.checkedAt = now;
+	entry.usedAt = now;
+	_lru.push_front(key);
+	entry.lru = _lru.begin();
+	return &entry.file;
+}
+
+// Forgets key, e.g. once its file has been deleted
+void OpenFileCache::remove(const std::string &key)
+{
+	std::map<std::string, Entry>::iterator it = _entries.find(key);
+	if (it != _entries.end())
+		erase(it);
+}
+
+// Drops the entries not used within the inactive time, from the least recently used
+void OpenFileCache::expire(unsigned long now)
+{
+	while (!_lru.empty())
+	{
+		std::map<std::string, Entry>::iterator it = _entries.find(_lru.back());
+		if (now - it->second.usedAt < _inactiveMs)
+			return;
+		erase(it);
+	}
+}
+
+void OpenFileCache::erase(std::map<std::string, Entry>::iterator it)
+{
+	if (it->second.file.fd != -1)
+		close(it->second.file.fd);
+	_lru.erase(it->second.lru);
+	_entries.erase(it);
+}
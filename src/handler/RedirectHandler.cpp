@@ -10,6 +10,7 @@ void RedirectHandler::handle(const Request &req, Response &res)
 	std::string url = _route.getRedirectURL();
 	if (url.empty()) {
 		res.setError(500, _config);
+		res.applyCachePolicy(_route);
 		return;
 	}
 	res.setHeader("Location", url);
@@ -17,5 +18,6 @@ void RedirectHandler::handle(const Request &req, Response &res)
 	int code = _route.getRedirectStatusCode();
 	if (code < 300 || code >= 400)
 		code = 302;
-	res.setStatusLine(code, httpStatusMessage(code));
+	res.setStatus(code);
+	res.applyCachePolicy(_route);
 }
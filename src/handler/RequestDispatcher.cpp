@@ -10,7 +10,8 @@ RequestDispatcher &RequestDispatcher::operator=(const RequestDispatcher &obj)
 
 RequestDispatcher::~RequestDispatcher() {}
 
-IRequestHandler *RequestDispatcher::selectHandler(const Request &req, const Route &route, const ServerConfig &config) const
+IRequestHandler *RequestDispatcher::selectHandler(const Request &req, const Route &route, const ServerConfig &config, const FileCaches &caches,
+	unsigned long &rangeResponses) const
 {
 	if (!route.isMethodAllowed(req.getMethod()))
 	{
@@ -22,13 +23,18 @@ IRequestHandler *RequestDispatcher::selectHandler(const Request &req, const Rout
 		debugMsg("Selecting RedirectHandler");
 		return new RedirectHandler(route, config);
 	}
+	if (route.isCacheStatus())
+	{
+		debugMsg("Selecting CacheStatusHandler");
+		return new CacheStatusHandler(config, caches);
+	}
 	if (isCgiRequest(req, route) && (req.getMethod() == "GET" || req.getMethod() == "POST"))
 	{
 		std::string ext = toLower(getFileExtension(req.getTarget()));
 		debugMsg("Selecting CgiHandler for extension: " + ext);
 		return new CgiHandler(route, config);
 	}
-	if (req.getMethod() == "POST" && !route.getUploadDir().empty() && req.getHeader("content-type").find("multipart/form-data") != std::string::npos)
+	if (isMultipartUpload(req, route))
 	{
 		debugMsg("Selecting UploadHandler");
 		return new UploadHandler(route, config);
@@ -41,7 +47,7 @@ IRequestHandler *RequestDispatcher::selectHandler(const Request &req, const Rout
 	if (req.getMethod() == "GET" || req.getMethod() == "DELETE")
 	{
 		debugMsg("Selecting StaticFileHandler");
-		return new StaticFileHandler(route, config);
+		return new StaticFileHandler(route, config, caches, rangeResponses);
 	}
 	if (req.getMethod() == "POST")
 	{
@@ -50,6 +56,15 @@ IRequestHandler *RequestDispatcher::selectHandler(const Request &req, const Rout
 	return NULL;
 }
 
+// Requests that selectHandler() gives to the UploadHandler as multipart uploads;
+// their body is streamed into the upload_dir as it arrives, so this is decided
+// from the header alone
+bool RequestDispatcher::isMultipartUpload(const Request &req, const Route &route) const
+{
+	return req.getMethod() == "POST" && route.isMethodAllowed("POST") && !route.isRedirect()
+		&& !isCgiRequest(req, route) && !route.getUploadDir().empty()
+		&& req.getHeader("content-type").find("multipart/form-data") != std::string::npos;
+}
 
 std::string RequestDispatcher::getFileExtension(const std::string &path) const
 {
@@ -20,8 +20,13 @@ static std::map<std::string, std::string> createMimeTypeMap()
 
 static const std::map<std::string, std::string> mimeTypeMap = createMimeTypeMap();
 
-StaticFileHandler::StaticFileHandler(const StaticFileHandler &obj): _route(obj._route), _config(obj._config) {}
-StaticFileHandler::StaticFileHandler(const Route &route, const ServerConfig &config): _route(route), _config(config) {}
+// A Range header asking for more ranges than this is ignored and the whole
+// file is sent, as with NGINX's max_ranges
+static const std::size_t MAX_RANGES = 16;
+
+StaticFileHandler::StaticFileHandler(const StaticFileHandler &obj): _route(obj._route), _config(obj._config), _caches(obj._caches), _rangeResponses(obj._rangeResponses) {}
+StaticFileHandler::StaticFileHandler(const Route &route, const ServerConfig &config, const FileCaches &caches, unsigned long &rangeResponses)
+	: _route(route), _config(config), _caches(caches), _rangeResponses(rangeResponses) {}
 StaticFileHandler::~StaticFileHandler(void) {}
 
 /*
@@ -29,46 +34,94 @@ StaticFileHandler::~StaticFileHandler(void) {}
 	- If it is a directory, look for index file
 		- if found, serve it
 		- if no index file, check if autoindex
-			- if autoindex OFF, return 403 Forbidden
+			- if autoindex OFF, return 404 Not Found
 			- if autoindex ON, return HTML page of directory listing
 	- if file doesn't exist, 404 Not Found
-	- else read file and general 200 response
+	- else open file and generate 200 response
+	With open_file_cache on, the outcome of a lookup is cached and a hit skips
+	straight to the response
+	With content_cache on, small files are answered with a response rendered ahead
+	With gzip on, small files are compressed for clients accepting it, and the
+	compressed response is kept in the content_cache, or in a cache of its own
+	when content_cache is off
+	A client that already holds the file (If-None-Match / If-Modified-Since)
+	gets a bodiless 304, with the ETag of the encoding a 200 would have used
+	A Range request gets 206 with the requested ranges of the file, or 416
+	With gzip_static on, a client accepting gzip gets file.gz instead when it
+	is at least as recent as the file
+	Whatever the outcome, the location's expires and add_header fields are added
 */
 void StaticFileHandler::handle(const Request &req, Response &res)
+{
+	serve(req, res);
+	res.applyCachePolicy(_route);
+}
+
+void StaticFileHandler::serve(const Request &req, Response &res)
 {
 	std::string relative = req.getTarget().substr(_route.getLocation().length());
 	std::string path = joinPath(_route.getRoot(), relative);
 
-	struct stat s;
-	if (stat(path.c_str(), &s) != 0) 
+	if (req.getMethod() == "DELETE") 
 	{
-		res.setError(404, _config);
+		handleDelete(res, path);
 		return;
 	}
-	if (!isSafePath(path)) 
+
+	std::string key = _route.getLocation() + "\n" + path;
+	OpenFile found;
+	const OpenFile *file = findFile(key, path, found);
+	if (!file)
 	{
-		res.setError(403, _config);
+		handleDirectory(req, res, path);
 		return;
 	}
-
-	if (req.getMethod() == "DELETE") 
+	OpenFile gzipFound;
+	if (file->status == 0 && _route.getGzipStatic() && acceptsCoding(req.getHeader("accept-encoding"), "gzip"))
 	{
-		if (S_ISDIR(s.st_mode)) 
+		const OpenFile *gzip = findGzipVariant(key + "\ngzip_static", *file, gzipFound);
+		if (gzip)
 		{
-			res.setError(403, _config);
-			return;
+			if (file == &found)
+				close(found.fd);
+			file = gzip;
+			key += "\ngzip_static";
 		}
-		if (!handleDelete(res, path))
-			res.setError(500, _config);
-		return;
+		else if (file != &found)
+			file = findFile(key, path, found); // the lookup may have evicted it
 	}
-	if (S_ISDIR(s.st_mode)) {
-		if (!handleDirectory(req, res, path))
-			return;
+	bool owned = (file == &found || file == &gzipFound); // otherwise the cache holds the descriptor
+	// The coding a 200 would use; a 304 carries the same validator as that 200
+	bool small = file->status == 0 && file->fd != -1 && file->size <= _config.getContentCacheMaxFile();
+	ContentCoding coding = CODING_IDENTITY;
+	if (small && file->contentEncoding.empty() && isCompressible(_route, file->mimeType, file->size))
+		coding = negotiateCoding(req);
+	if (file->status == 0 && isNotModified(req, *file))
+	{
+		if (owned)
+			close(file->fd);
+		res.setStatus(304);
+		setFileHeaders(res, *file, coding);
+		return;
 	}
-	if (!serveFile(res, path)) {
-		res.setError(500, _config);
+	std::vector<FileRange> ranges;
+	int status = (file->status == 0) ? selectRanges(req, *file, ranges) : 200;
+	bool inMemory = status == 200 && small;
+	if (!inMemory)
+		coding = CODING_IDENTITY;
+	if (inMemory && (_caches.content || coding != CODING_IDENTITY) && serveRendered(res, key, *file, coding))
+	{
+		if (owned)
+			close(file->fd);
+		return;
 	}
+	int fd = file->fd;
+	if (!owned && fd != -1)
+		fd = dupCloexec(fd);
+	if (status == 200)
+		serveFile(res, *file, fd);
+	else
+		serveRanges(res, *file, fd, ranges);
 }
 
 std::string StaticFileHandler::resolvePath(const Request &req) const {
@@ -115,39 +168,362 @@ bool StaticFileHandler::isSafePath(const std::string &path) const
 	return false;
 }
 
-bool StaticFileHandler::handleDirectory(const Request &req, Response &res, std::string &path) const {
-	std::string indexPath;
-	if (!findIndexFile(path, indexPath)) {
-		if (_route.getAutoindex()) {
-			std::string listing = generateDirectoryListing(path, req.getTarget());
-			res.setStatusLine(200, httpStatusMessage(200));
-			res.setHeader("Content-Type", "text/html");
-			res.setBody(listing);
-		} 
-		else {
-			res.setError(404, _config);
+// A directory without an index file: its listing with autoindex on, else 404
+void StaticFileHandler::handleDirectory(const Request &req, Response &res, const std::string &path) const {
+	if (_route.getAutoindex()) {
+		std::string listing = generateDirectoryListing(path, req.getTarget());
+		res.setStatus(200);
+		res.setHeader("Content-Type", "text/html");
+		res.setBody(listing);
+	} 
+	else {
+		res.setError(404, _config);
+	}
+}
+
+void StaticFileHandler::handleDelete(Response &res, const std::string &path) const {
+	struct stat s;
+	if (stat(path.c_str(), &s) != 0) {
+		res.setError(404, _config);
+		return;
+	}
+	if (!isSafePath(path) || S_ISDIR(s.st_mode)) {
+		res.setError(403, _config);
+		return;
+	}
+	if (remove(path.c_str()) != 0) {
+		res.setError(500, _config);
+		return;
+	}
+	std::string key = _route.getLocation() + "\n" + path;
+	if (_caches.openFiles) {
+		_caches.openFiles->remove(key);
+		_caches.openFiles->remove(key + "\ngzip_static");
+	}
+	if (_caches.content) {
+		_caches.content->remove(key);
+		_caches.content->remove(key + "\ngzip_static");
+		_caches.content->remove(key + "\ngzip");
+		_caches.content->remove(key + "\ndeflate");
+	}
+	if (_caches.compressed) {
+		_caches.compressed->remove(key + "\ngzip");
+		_caches.compressed->remove(key + "\ndeflate");
+	}
+	res.setStatus(204);
+}
+
+// The lookup of path, from the open_file_cache when it is on; otherwise found,
+// whose descriptor the caller then owns
+// Returns NULL for a directory without an index file
+const OpenFile *StaticFileHandler::findFile(const std::string &key, const std::string &path, OpenFile &found) const {
+	const OpenFile *cached = _caches.openFiles ? _caches.openFiles->find(key) : NULL;
+	if (cached)
+		return cached;
+	if (!lookupFile(path, found))
+		return NULL;
+	if (_caches.openFiles)
+		cached = _caches.openFiles->insert(key, found);
+	return cached ? cached : &found;
+}
+
+// With gzip_static on, the file's precompressed sibling (file.gz), looked up as
+// findFile() does; it is served as the original with Content-Encoding: gzip
+// Returns NULL when there is none or it is older than the original
+const OpenFile *StaticFileHandler::findGzipVariant(const std::string &key, const OpenFile &original, OpenFile &found) const {
+	time_t mtime = original.mtime; // original may be evicted by the insert below
+	const OpenFile *gzip = _caches.openFiles ? _caches.openFiles->find(key) : NULL;
+	if (!gzip) {
+		if (!lookupFile(original.path + ".gz", found))
+			return NULL;
+		if (found.status == 0) {
+			found.mimeType = original.mimeType;
+			found.contentEncoding = "gzip";
 		}
+		if (_caches.openFiles)
+			gzip = _caches.openFiles->insert(key, found);
+		if (!gzip)
+			gzip = &found;
+	}
+	if (gzip->status != 0 || gzip->mtime < mtime) {
+		if (gzip == &found && found.fd != -1)
+			close(found.fd);
+		return NULL;
+	}
+	return gzip;
+}
+
+// Finds the file to serve for path and opens it, as the open_file_cache stores it;
+// file.status is the error to answer with when there is none
+// Returns false for a directory without an index file
+bool StaticFileHandler::lookupFile(const std::string &path, OpenFile &file) const {
+	struct stat s;
+	if (stat(path.c_str(), &s) != 0) {
+		file.status = 404;
+		return true;
+	}
+	if (!isSafePath(path)) {
+		file.status = 403;
+		return true;
+	}
+	file.path = path;
+	if (S_ISDIR(s.st_mode) && !findIndexFile(path, file.path))
 		return false;
+	file.fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file.fd == -1 || fstat(file.fd, &s) != 0 || !S_ISREG(s.st_mode)) {
+		if (file.fd != -1)
+			close(file.fd);
+		file.fd = -1;
+		file.status = 500;
+		return true;
 	}
-	path = indexPath;
+	file.size = static_cast<std::size_t>(s.st_size);
+	file.mtime = s.st_mtime;
+	file.inode = s.st_ino;
+	file.mimeType = getMimeType(file.path);
+	std::ostringstream etag;
+	etag << std::hex << '"' << file.inode << '-' << file.size << '-' << file.mtime << '"';
+	file.etag = etag.str();
+	file.lastModified = httpDate(file.mtime);
 	return true;
 }
 
-bool StaticFileHandler::handleDelete(Response &res, const std::string &path) const {
-	if (remove(path.c_str()) != 0)
+// The file is sent by the connection straight from the page cache, so it is
+// never read into memory; the response takes ownership of fd
+void StaticFileHandler::serveFile(Response &res, const OpenFile &file, int fd) const {
+	if (file.status != 0) {
+		res.setError(file.status, _config);
+		return;
+	}
+	if (fd == -1) {
+		res.setError(500, _config);
+		return;
+	}
+	res.setFile(fd, file.size, file.mimeType);
+	setFileHeaders(res, file);
+}
+
+// A byte position of a Range header; values too large for size_t saturate
+static bool parseBytePosition(const std::string &str, std::size_t &pos)
+{
+	if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos)
 		return false;
-	res.setStatusLine(204, httpStatusMessage(204));
+	pos = 0;
+	for (std::size_t i = 0; i < str.size(); ++i)
+	{
+		std::size_t digit = str[i] - '0';
+		if (pos > (static_cast<std::size_t>(-1) - digit) / 10)
+			pos = static_cast<std::size_t>(-1);
+		else
+			pos = pos * 10 + digit;
+	}
 	return true;
 }
 
-bool StaticFileHandler::serveFile(Response &res, const std::string &path) const {
-	if (access(path.c_str(), R_OK) != 0)
+// The ranges of file a request asks for, in the order they were asked
+// Returns 206 with the satisfiable ones in ranges, 416 when none is, or 200 when
+// the whole file is to be sent: no Range, a malformed one, too many ranges, or
+// an If-Range that no longer matches the file
+int StaticFileHandler::selectRanges(const Request &req, const OpenFile &file, std::vector<FileRange> &ranges) const {
+	std::string header = req.getHeader("range");
+	if (header.compare(0, 6, "bytes=") != 0)
+		return 200;
+	std::string ifRange = req.getHeader("if-range");
+	if (!ifRange.empty()) {
+		time_t date;
+		if (ifRange[0] == '"') {
+			if (ifRange != file.etag)
+				return 200;
+		}
+		else if (!parseHttpDate(ifRange, date) || date != file.mtime)
+			return 200;
+	}
+
+	std::istringstream specs(header.substr(6));
+	std::string spec;
+	std::size_t count = 0;
+	while (std::getline(specs, spec, ',')) {
+		std::string::size_type start = spec.find_first_not_of(" \t");
+		std::string::size_type end = spec.find_last_not_of(" \t");
+		if (start == std::string::npos)
+			continue;
+		spec = spec.substr(start, end - start + 1);
+		std::string::size_type dash = spec.find('-');
+		if (dash == std::string::npos || ++count > MAX_RANGES)
+			return 200;
+		std::size_t first, last;
+		FileRange range;
+		if (dash == 0) {
+			if (!parseBytePosition(spec.substr(1), last))
+				return 200;
+			if (last == 0 || file.size == 0)
+				continue;
+			range.length = std::min(last, file.size);
+			range.offset = file.size - range.length;
+		}
+		else {
+			if (!parseBytePosition(spec.substr(0, dash), first))
+				return 200;
+			last = file.size - 1;
+			if (dash + 1 < spec.size()) {
+				if (!parseBytePosition(spec.substr(dash + 1), last) || last < first)
+					return 200;
+			}
+			if (first >= file.size)
+				continue;
+			last = std::min(last, file.size - 1);
+			range.offset = first;
+			range.length = last - first + 1;
+		}
+		ranges.push_back(range);
+	}
+	if (count == 0)
+		return 200;
+	return ranges.empty() ? 416 : 206;
+}
+
+// 206 with the ranges of the file: one range is sent as the body, several as a
+// multipart/byteranges body whose parts are sent straight from the file
+// No range left means 416; the response takes ownership of fd
+void StaticFileHandler::serveRanges(Response &res, const OpenFile &file, int fd, const std::vector<FileRange> &ranges) const {
+	std::ostringstream size;
+	size << file.size;
+	if (ranges.empty()) {
+		if (fd != -1)
+			close(fd);
+		res.setError(416, _config);
+		res.setHeader("Content-Range", "bytes */" + size.str());
+		return;
+	}
+	if (fd == -1) {
+		res.setError(500, _config);
+		return;
+	}
+	res.setStatus(206);
+	if (ranges.size() == 1) {
+		std::ostringstream contentRange;
+		contentRange << "bytes " << ranges[0].offset << "-" << ranges[0].offset + ranges[0].length - 1 << "/" << file.size;
+		res.setHeader("Content-Type", file.mimeType);
+		res.setHeader("Content-Range", contentRange.str());
+		res.setFileBody(fd, ranges[0].offset, ranges[0].length);
+	}
+	else {
+		std::ostringstream boundary;
+		boundary << file.etag.substr(1, file.etag.size() - 2) << "-" << std::hex << ++_rangeResponses;
+		res.setHeader("Content-Type", "multipart/byteranges; boundary=" + boundary.str());
+		for (std::size_t i = 0; i < ranges.size(); ++i) {
+			std::ostringstream partHeader;
+			if (i > 0)
+				partHeader << "\r\n";
+			partHeader << "--" << boundary.str() << "\r\n"
+				<< "Content-Type: " << file.mimeType << "\r\n"
+				<< "Content-Range: bytes " << ranges[i].offset << "-" << ranges[i].offset + ranges[i].length - 1
+				<< "/" << file.size << "\r\n\r\n";
+			res.addBodyPart(partHeader.str());
+			res.addFileBodyPart(i + 1 < ranges.size() ? dupCloexec(fd) : fd, ranges[i].offset, ranges[i].length);
+		}
+		res.addBodyPart("\r\n--" + boundary.str() + "--\r\n");
+	}
+	setFileHeaders(res, file);
+}
+
+// Fields describing the file served, also sent with a 304: its validators,
+// range support and encoding; a body compressed on the fly only has a weak ETag
+// Vary is sent whenever the location may serve another encoding of the file
+void StaticFileHandler::setFileHeaders(Response &res, const OpenFile &file, ContentCoding coding) const {
+	res.setHeader("ETag", coding != CODING_IDENTITY ? "W/" + file.etag : file.etag);
+	res.setHeader("Last-Modified", file.lastModified);
+	res.setHeader("Accept-Ranges", "bytes");
+	if (coding != CODING_IDENTITY)
+		res.setHeader("Content-Encoding", codingName(coding));
+	else if (!file.contentEncoding.empty())
+		res.setHeader("Content-Encoding", file.contentEncoding);
+	if (_route.getGzipStatic() || _route.getGzip())
+		res.setHeader("Vary", "Accept-Encoding");
+}
+
+// Conditional GET: If-None-Match is checked against the ETag (weak comparison)
+// and takes precedence; otherwise If-Modified-Since against the mtime
+bool StaticFileHandler::isNotModified(const Request &req, const OpenFile &file) const {
+	std::string ifNoneMatch = req.getHeader("if-none-match");
+	if (!ifNoneMatch.empty()) {
+		std::istringstream tags(ifNoneMatch);
+		std::string tag;
+		while (std::getline(tags, tag, ',')) {
+			std::string::size_type start = tag.find_first_not_of(" \t");
+			std::string::size_type end = tag.find_last_not_of(" \t");
+			if (start == std::string::npos)
+				continue;
+			tag = tag.substr(start, end - start + 1);
+			if (tag.compare(0, 2, "W/") == 0)
+				tag.erase(0, 2);
+			if (tag == "*" || tag == file.etag)
+				return true;
+		}
 		return false;
-	std::string content;
-	if (!readFile(path, content))
+	}
+	std::string ifModifiedSince = req.getHeader("if-modified-since");
+	time_t since;
+	if (ifModifiedSince.empty() || !parseHttpDate(ifModifiedSince, since))
 		return false;
-	std::string mimeType = getMimeType(path);
-	res.setFile(content, mimeType);
+	return file.mtime <= since;
+}
+
+// Answers with the whole response for file rendered in memory, compressed
+// with coding unless it is identity; with content_cache on it is taken from
+// the cache, or rendered and cached first when there is none or file has changed
+// With content_cache off, compressed responses still go through a cache of
+// their own, so a file is not compressed again for every request
+// Returns false when it cannot be rendered; file is then served as usual
+bool StaticFileHandler::serveRendered(Response &res, const std::string &key, const OpenFile &file, ContentCoding coding) const {
+	std::string variantKey = key;
+	if (coding != CODING_IDENTITY)
+		variantKey += std::string("\n") + codingName(coding);
+	ContentCache *cache = (_caches.content || coding == CODING_IDENTITY) ? _caches.content : _caches.compressed;
+	const CachedContent *content = cache ? cache->find(variantKey, file) : NULL;
+	if (!content) {
+		Response rendered;
+		if (!renderFile(rendered, file, coding))
+			return false;
+		if (!cache) {
+			res = rendered;
+			return true;
+		}
+		std::size_t headerLength = rendered.headerSize();
+		std::string bytes(headerLength, '\0');
+		rendered.serializeHeader(&bytes[0]);
+		std::string body;
+		rendered.releaseBody(body);
+		bytes += body;
+		content = cache->insert(variantKey, file, bytes, headerLength);
+		if (!content)
+			return false;
+	}
+	res.setStatus(200);
+	res.setRendered(content->rendered, content->headerLength);
+	return true;
+}
+
+// The 200 response for file with the whole body in memory
+bool StaticFileHandler::renderFile(Response &res, const OpenFile &file, ContentCoding coding) const {
+	std::string body(file.size, '\0');
+	std::size_t done = 0;
+	while (done < body.size()) {
+		ssize_t n = pread(file.fd, &body[done], body.size() - done, done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		done += n;
+	}
+	if (coding != CODING_IDENTITY) {
+		std::string compressed;
+		if (!compressBody(body, compressed, coding, _route.getGzipCompLevel()))
+			return false;
+		body.swap(compressed);
+	}
+	res.setFile(body, file.mimeType);
+	setFileHeaders(res, file, coding);
 	return true;
 }
 
@@ -167,18 +543,6 @@ bool StaticFileHandler::findIndexFile(const std::string &dir, std::string &index
 	return false;
 }
 
-bool StaticFileHandler::readFile(const std::string &path, std::string &content) const
-{
-	std::ifstream file(path.c_str());
-	if (!file.is_open())
-		return false;
-	std::ostringstream buffer;
-	buffer << file.rdbuf();
-	file.close();
-	content = buffer.str();
-	return true;
-}
-
 std::string StaticFileHandler::getMimeType(const std::string &filename) const
 {
 	std::string::size_type dot = filename.rfind('.');
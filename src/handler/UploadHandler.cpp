@@ -28,36 +28,10 @@ void UploadHandler::handle(const Request &req, Response &res)
 
 	const std::map<std::string, std::vector<UploadedFile> >& uploadedFiles = req.getUploadedFiles();
 
-	// Case 1: Multipart file uploads
+	// Case 1: Multipart file uploads, already streamed into the upload_dir while the body arrived
 	if (!uploadedFiles.empty())
 	{
-		for (std::map<std::string, std::vector<UploadedFile> >::const_iterator it = uploadedFiles.begin(); it != uploadedFiles.end(); ++it)
-		{
-			const std::vector<UploadedFile>& fileList = it->second;
-			for (std::vector<UploadedFile>::const_iterator fileIt = fileList.begin(); fileIt != fileList.end(); ++fileIt)
-			{
-				std::string safeFilename = sanitizeFilename(fileIt->filename);
-				std::string fullPath = uploadDir + "/" + safeFilename;
-
-				if (access(fullPath.c_str(), F_OK) == 0)
-				{
-					res.setError(409, _config); // File already exists
-					return;
-				}
-				if (!isSafePath(fullPath, uploadDir))
-				{
-					res.setError(403, _config); // Unsafe path
-					return;
-				}
-				if (!saveFile(fullPath, fileIt->content))
-				{
-					debugMsg("333");
-					res.setError(500, _config); // Write failure
-					return;
-				}
-			}
-		}
-		res.setStatusLine(201, httpStatusMessage(201));
+		res.setStatus(201);
 		res.setHeader("Location", uploadDir);
 		return;
 	}
@@ -66,7 +40,7 @@ void UploadHandler::handle(const Request &req, Response &res)
 	{
 		// Multipart form with no files — only fields
 		debugMsg("Multipart form received with no file uploads.");
-		res.setStatusLine(204, "No Content");
+		res.setStatus(204);
 		return;
 	                                                                                                              }
 
@@ -86,90 +60,46 @@ void UploadHandler::handle(const Request &req, Response &res)
 			res.setError(403, _config);
 			return;
 		}
-		if (!saveFile(fullPath, req.getBody()))
+		if (!saveBody(fullPath, req.getBody()))
 		{
 			res.setError(500, _config);
 			return;
 		}
 
-		res.setStatusLine(201, httpStatusMessage(201));
+		res.setStatus(201);
 		res.setHeader("Location", fullPath);
 		return;
 	}
 
 	// Case 3: Empty POST
-	res.setStatusLine(204, "No Content");
+	res.setStatus(204);
 }
 
 std::string UploadHandler::generateTimestamp() const
 {
 	time_t now = time(NULL);
+	struct tm local;
 	char buf[32];
-	strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", localtime(&now));
+	localtime_r(&now, &local);
+	strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", &local);
 	return std::string(buf);
 }
 
 
-// To avoid filenames like ../../../etc/passwd that will escape intended upload directory
-// keeps alphanumerics, dots, underscores and hyphens; replace all others with _
-std::string UploadHandler::sanitizeFilename(const std::string& filename)
-{
-	std::string clean;
-	for (size_t i = 0; i < filename.size(); ++i)
-	{
-		char c = filename[i];
-		if (std::isalnum(c) || c == '.' || c == '_' || c == '-')
-			clean += c;
-		else
-			clean += '_';
-	}
-	if (clean.empty())
-		clean = "upload";
-	return clean;
-}
-
-bool UploadHandler::saveFile(const std::string &filename, const std::string &content) const
+// Copies the body to its file through a BodyReader, so a spooled body is never held in memory
+bool UploadHandler::saveBody(const std::string &filename, const RequestBody &body) const
 {
 	std::ofstream ofs(filename.c_str(), std::ios::binary);
 	if (!ofs.is_open())
 		return false;
-	ofs.write(content.c_str(), content.length());
-	if (!ofs)
-	{
-		ofs.close();
-		return false;
-	}
-	ofs.close();
-	return true;
-}
-
-bool UploadHandler::isSafePath(const std::string &path, const std::string &baseDir) const
-{
-	char *resolvedBase = realpath(baseDir.c_str(), NULL);
-	if (!resolvedBase)
-		return false;
-
-	// Get directory part of the path
-	std::string dirPart = path.substr(0, path.find_last_of("/"));
-	char *resolvedDir = realpath(dirPart.c_str(), NULL);
-
-	if (!resolvedDir)
+	BodyReader reader(body);
+	char buffer[65536];
+	ssize_t bytesRead;
+	while ((bytesRead = reader.read(buffer, sizeof(buffer))) > 0)
 	{
-		free(resolvedBase);
-		return false;
+		ofs.write(buffer, bytesRead);
+		if (!ofs)
+			return false;
 	}
-
-	std::string baseStr(resolvedBase);
-	std::string dirStr(resolvedDir);
-
-	free(resolvedBase);
-	free(resolvedDir);
-
-	if (dirStr == baseStr)
-		return true;
-	if (dirStr.compare(0, baseStr.length(), baseStr) == 0 &&
-		(dirStr[baseStr.length()] == '/' || dirStr.length() == baseStr.length()))
-		return true;
-
-	return false;
+	return bytesRead == 0;
 }
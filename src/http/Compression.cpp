@@ -0,0 +1,111 @@
+#include "../../includes/Compression.hpp"
+#include <zlib.h>
+
+// Whether Accept-Encoding allows coding, by name or through "*", with a non-zero q
+bool acceptsCoding(const std::string &acceptEncoding, const std::string &coding)
+{
+	std::istringstream codings(toLower(acceptEncoding));
+	std::string entry;
+	int named = -1, any = -1; // whether q > 0, or -1 when not listed
+	while (std::getline(codings, entry, ','))
+	{
+		std::string::size_type semicolon = entry.find(';');
+		std::string name = entry.substr(0, semicolon);
+		std::string::size_type start = name.find_first_not_of(" \t");
+		if (start == std::string::npos)
+			continue;
+		name = name.substr(start, name.find_last_not_of(" \t") - start + 1);
+		bool accepted = true;
+		if (semicolon != std::string::npos)
+		{
+			std::string::size_type q = entry.find("q=", semicolon);
+			if (q != std::string::npos)
+				accepted = std::atof(entry.c_str() + q + 2) > 0;
+		}
+		if (name == coding || (coding == "gzip" && name == "x-gzip"))
+			named = accepted;
+		else if (name == "*")
+			any = accepted;
+	}
+	return named != -1 ? named == 1 : any == 1;
+}
+
+// The coding to compress a response to this request with; gzip is preferred
+ContentCoding negotiateCoding(const Request &req)
+{
+	std::string acceptEncoding = req.getHeader("accept-encoding");
+	if (acceptEncoding.empty())
+		return CODING_IDENTITY;
+	if (acceptsCoding(acceptEncoding, "gzip"))
+		return CODING_GZIP;
+	if (acceptsCoding(acceptEncoding, "deflate"))
+		return CODING_DEFLATE;
+	return CODING_IDENTITY;
+}
+
+const char *codingName(ContentCoding coding)
+{
+	if (coding == CODING_GZIP)
+		return "gzip";
+	if (coding == CODING_DEFLATE)
+		return "deflate";
+	return "identity";
+}
+
+// Whether the location's gzip settings cover a body of this type and length;
+// text/html is always covered, as in NGINX
+bool isCompressible(const Route &route, const std::string &contentType, std::size_t length)
+{
+	if (!route.getGzip() || length < route.getGzipMinLength())
+		return false;
+	std::string type = toLower(contentType.substr(0, contentType.find(';')));
+	std::string::size_type end = type.find_last_not_of(" \t");
+	type.erase(end == std::string::npos ? 0 : end + 1);
+	if (type == "text/html")
+		return true;
+	const std::vector<std::string> &types = route.getGzipTypes();
+	for (std::size_t i = 0; i < types.size(); ++i)
+	{
+		if (types[i] == "*" || types[i] == type)
+			return true;
+	}
+	return false;
+}
+
+// Compresses in at the given zlib level (1-9) into out in one pass
+bool compressBody(const std::string &in, std::string &out, ContentCoding coding, int level)
+{
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	int windowBits = (coding == CODING_GZIP) ? 15 + 16 : 15; // +16 writes a gzip wrapper
+	if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return false;
+	out.resize(deflateBound(&stream, in.size()));
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+	stream.avail_in = in.size();
+	stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+	stream.avail_out = out.size();
+	int status = deflate(&stream, Z_FINISH);
+	out.resize(stream.total_out);
+	deflateEnd(&stream);
+	return status == Z_STREAM_END;
+}
+
+// Compresses a string body (CGI output, form results, directory listings) when
+// the location has gzip on and the client accepts it; Vary is announced for
+// every body that could have been compressed, so shared caches keep both
+void compressResponse(const Request &req, const Route &route, Response &res)
+{
+	int code = res.getStatusCode();
+	if (code < 200 || code == 204 || code == 206 || code == 304 || !res.hasStringBody()
+		|| !res.getHeader("Content-Encoding").empty()
+		|| !isCompressible(route, res.getHeader("Content-Type"), res.getBody().size()))
+		return;
+	res.setHeader("Vary", "Accept-Encoding");
+	ContentCoding coding = negotiateCoding(req);
+	std::string compressed;
+	if (coding == CODING_IDENTITY || !compressBody(res.getBody(), compressed, coding, route.getGzipCompLevel()))
+		return;
+	res.setBody(compressed);
+	res.setHeader("Content-Encoding", codingName(coding));
+}
@@ -0,0 +1,350 @@
+#include "../../includes/MultipartParser.hpp"
+
+// A reused parser keeps a pending buffer up to this size for the next upload
+static const std::size_t MAX_RETAINED_PENDING = 64 * 1024;
+// RFC 2046: a boundary is 1 to 70 characters
+static const std::size_t MAX_BOUNDARY_LENGTH = 70;
+
+MultipartParser::MultipartParser(void)
+	: _state(PREAMBLE), _active(false), _complete(false), _errorCode(0), _delimiter(), _uploadDir(),
+	  _maxFieldSize(DEFAULT_CLIENT_BODY_BUFFER_SIZE), _pending(), _received(0), _fieldName(), _fieldValue(), _file(), _fd(-1), _fields(), _files() {}
+
+// Copies share the file being written through a duplicated descriptor
+MultipartParser::MultipartParser(const MultipartParser &obj)
+	: _state(obj._state), _active(obj._active), _complete(obj._complete), _errorCode(obj._errorCode),
+	  _delimiter(obj._delimiter), _uploadDir(obj._uploadDir),
+	  _maxFieldSize(obj._maxFieldSize), _pending(obj._pending), _received(obj._received),
+	  _fieldName(obj._fieldName), _fieldValue(obj._fieldValue), _file(obj._file),
+	  _fd(obj._fd != -1 ? dupCloexec(obj._fd) : -1), _fields(obj._fields), _files(obj._files) {}
+
+MultipartParser::~MultipartParser(void) { closeFile(); }
+
+MultipartParser &MultipartParser::operator=(const MultipartParser &obj)
+{
+	if (this != &obj)
+	{
+		closeFile();
+		_state = obj._state;
+		_active = obj._active;
+		_complete = obj._complete;
+		_errorCode = obj._errorCode;
+		_delimiter = obj._delimiter;
+		_uploadDir = obj._uploadDir;
+		_maxFieldSize = obj._maxFieldSize;
+		_pending = obj._pending;
+		_received = obj._received;
+		_fieldName = obj._fieldName;
+		_fieldValue = obj._fieldValue;
+		_file = obj._file;
+		_fd = (obj._fd != -1) ? dupCloexec(obj._fd) : -1;
+		_fields = obj._fields;
+		_files = obj._files;
+	}
+	return (*this);
+}
+
+bool MultipartParser::isActive(void) const { return _active; }
+
+// The closing delimiter has been seen
+bool MultipartParser::isComplete(void) const { return _complete; }
+
+int MultipartParser::getErrorCode(void) const { return _errorCode; }
+
+// Body bytes fed so far
+std::size_t MultipartParser::getReceived(void) const { return _received; }
+
+const std::map<std::string, std::string> &MultipartParser::getFields(void) const { return _fields; }
+
+const std::map<std::string, std::vector<UploadedFile> > &MultipartParser::getFiles(void) const { return _files; }
+
+// Value of a parameter in a header such as
+// Content-Type: multipart/form-data; boundary=xyz or
+// Content-Disposition: form-data; name="file"; filename="a.txt"
+static bool headerParam(const std::string &header, const std::string &key, std::string &value)
+{
+	std::string::size_type pos = header.find(';');
+	while (pos != std::string::npos)
+	{
+		++pos;
+		while (pos < header.size() && (header[pos] == ' ' || header[pos] == '\t'))
+			++pos;
+		std::string::size_type eq = header.find('=', pos);
+		if (eq == std::string::npos)
+			return false;
+		std::string name = toLower(trimR(header.substr(pos, eq - pos)));
+		std::string parsed;
+		std::string::size_type end;
+		if (eq + 1 < header.size() && header[eq + 1] == '"')
+		{
+			end = header.find('"', eq + 2);
+			if (end == std::string::npos)
+				return false;
+			parsed = header.substr(eq + 2, end - eq - 2);
+			end = header.find(';', end);
+		}
+		else
+		{
+			end = header.find(';', eq + 1);
+			parsed = header.substr(eq + 1, end == std::string::npos ? std::string::npos : end - eq - 1);
+		}
+		if (name == key)
+		{
+			value = trimR(parsed);
+			return true;
+		}
+		pos = end;
+	}
+	return false;
+}
+
+// Takes the boundary from the Content-Type header; files are saved in uploadDir
+// and form field values larger than maxFieldSize are refused
+bool MultipartParser::start(const std::string &contentType, const std::string &uploadDir, std::size_t maxFieldSize)
+{
+	reset();
+	std::string boundary;
+	if (!headerParam(contentType, "boundary", boundary) || boundary.empty() || boundary.size() > MAX_BOUNDARY_LENGTH)
+		return fail(400);
+	_delimiter = "\r\n--" + boundary;
+	_pending = "\r\n"; // so the first delimiter, at the very start of the body, looks like the others
+	_uploadDir = uploadDir;
+	_maxFieldSize = maxFieldSize;
+	_active = true;
+	return true;
+}
+
+// Parses the next piece of the body; false once the upload has failed (see getErrorCode())
+bool MultipartParser::feed(const char *data, std::size_t length)
+{
+	if (_errorCode)
+		return false;
+	_received += length;
+	if (_state == EPILOGUE)
+		return true;
+	_pending.append(data, length);
+	return parse();
+}
+
+// Prepares for the next request, removing the files of an unfinished upload
+void MultipartParser::reset(void)
+{
+	closeFile();
+	if (!_complete)
+	{
+		if (!_file.path.empty())
+			unlink(_file.path.c_str());
+		for (std::map<std::string, std::vector<UploadedFile> >::const_iterator it = _files.begin(); it != _files.end(); ++it)
+			for (std::size_t i = 0; i < it->second.size(); ++i)
+				unlink(it->second[i].path.c_str());
+	}
+	_state = PREAMBLE;
+	_active = false;
+	_complete = false;
+	_errorCode = 0;
+	_delimiter.clear();
+	_uploadDir.clear();
+	_maxFieldSize = DEFAULT_CLIENT_BODY_BUFFER_SIZE;
+	if (_pending.capacity() > MAX_RETAINED_PENDING)
+		std::string().swap(_pending);
+	else
+		_pending.clear();
+	_received = 0;
+	_fieldName.clear();
+	_fieldValue.clear();
+	_file = UploadedFile();
+	_fields.clear();
+	_files.clear();
+}
+
+// Consumes as much of the pending bytes as can be parsed
+bool MultipartParser::parse(void)
+{
+	while (true)
+	{
+		switch (_state)
+		{
+			case PREAMBLE:
+			{
+				std::string::size_type pos = _pending.find(_delimiter);
+				if (pos == std::string::npos)
+				{
+					if (_pending.size() >= _delimiter.size())
+						_pending.erase(0, _pending.size() - _delimiter.size() + 1);
+					return true;
+				}
+				_pending.erase(0, pos + _delimiter.size());
+				_state = DELIMITER_END;
+				break;
+			}
+
+			case DELIMITER_END:
+			{
+				std::size_t padding = 0; // linear whitespace is allowed after a delimiter
+				while (padding < _pending.size() && (_pending[padding] == ' ' || _pending[padding] == '\t'))
+					++padding;
+				if (_pending.size() - padding < 2)
+					return true;
+				if (_pending.compare(padding, 2, "--") == 0)
+				{
+					_complete = true;
+					_state = EPILOGUE;
+				}
+				else if (_pending.compare(padding, 2, "\r\n") == 0)
+					_state = PART_HEADERS;
+				else
+					return fail(400);
+				_pending.erase(0, padding + 2);
+				break;
+			}
+
+			case PART_HEADERS:
+			{
+				bool noHeaders = _pending.size() >= 2 && _pending[0] == '\r' && _pending[1] == '\n';
+				std::string::size_type end = noHeaders ? 0 : _pending.find("\r\n\r\n");
+				if (end == std::string::npos)
+				{
+					if (_pending.size() > MAX_PART_HEADER_SIZE)
+						return fail(400);
+					return true;
+				}
+				if (!parsePartHeaders(end))
+					return false;
+				_pending.erase(0, noHeaders ? 2 : end + 4);
+				_state = PART_DATA;
+				break;
+			}
+
+			case PART_DATA:
+				if (!parsePartData())
+					return false;
+				if (_state == PART_DATA)
+					return true;
+				break;
+
+			case EPILOGUE:
+				_pending.clear();
+				return true;
+		}
+	}
+}
+
+// Passes on everything up to the next delimiter, holding back a tail that
+// could be the start of a delimiter split between two reads
+bool MultipartParser::parsePartData(void)
+{
+	std::string::size_type pos = _pending.find(_delimiter);
+	if (pos == std::string::npos)
+	{
+		std::size_t keep = std::min(_pending.size(), _delimiter.size() - 1);
+		std::size_t ready = _pending.size() - keep;
+		if (!writePart(_pending.data(), ready))
+			return false;
+		_pending.erase(0, ready);
+		return true;
+	}
+	if (!writePart(_pending.data(), pos))
+		return false;
+	endPart();
+	_pending.erase(0, pos + _delimiter.size());
+	_state = DELIMITER_END;
+	return true;
+}
+
+// The part's Content-Disposition says whether it is a form field or a file
+bool MultipartParser::parsePartHeaders(std::size_t headerEnd)
+{
+	static const std::size_t prefixLength = std::strlen("content-disposition:");
+	std::string disposition;
+	std::size_t pos = 0;
+	while (pos < headerEnd)
+	{
+		std::string::size_type lineEnd = _pending.find("\r\n", pos);
+		if (lineEnd == std::string::npos || lineEnd > headerEnd)
+			lineEnd = headerEnd;
+		if (lineEnd - pos > prefixLength && strncasecmp(_pending.c_str() + pos, "content-disposition:", prefixLength) == 0)
+			disposition = _pending.substr(pos + prefixLength, lineEnd - pos - prefixLength);
+		pos = lineEnd + 2;
+	}
+	if (disposition.empty())
+		return fail(400);
+
+	std::string filename;
+	_fieldName.clear();
+	headerParam(disposition, "name", _fieldName);
+	headerParam(disposition, "filename", filename);
+	if (!filename.empty())
+		return openFile(filename);
+	if (_fieldName.empty())
+		return fail(400);
+	return true;
+}
+
+// Creates the part's file in the upload_dir; an existing file is never replaced
+bool MultipartParser::openFile(const std::string &filename)
+{
+	std::string path = _uploadDir + "/" + sanitizeFilename(filename);
+	if (!isSafePath(path, _uploadDir))
+		return fail(403);
+	_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (_fd == -1)
+		return fail(errno == EEXIST ? 409 : 500);
+	_file.filename = filename;
+	_file.path = path;
+	_file.size = 0;
+	debugMsg("Streaming upload to " + path);
+	return true;
+}
+
+bool MultipartParser::writePart(const char *data, std::size_t length)
+{
+	if (_fd == -1)
+	{
+		if (length > _maxFieldSize - _fieldValue.size())
+			return fail(413);
+		_fieldValue.append(data, length);
+		return true;
+	}
+	while (length > 0)
+	{
+		ssize_t written = write(_fd, data, length);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			errorMsg("Failed to write upload to " + _file.path);
+			return fail(500);
+		}
+		data += written;
+		length -= written;
+		_file.size += written;
+	}
+	return true;
+}
+
+void MultipartParser::endPart(void)
+{
+	if (_fd != -1)
+	{
+		closeFile();
+		_files[_fieldName].push_back(_file);
+		_file = UploadedFile();
+	}
+	else
+		_fields[_fieldName] = _fieldValue;
+	_fieldName.clear();
+	_fieldValue.clear();
+}
+
+void MultipartParser::closeFile(void)
+{
+	if (_fd != -1)
+		close(_fd);
+	_fd = -1;
+}
+
+bool MultipartParser::fail(int code)
+{
+	_errorCode = code;
+	closeFile();
+	return false;
+}
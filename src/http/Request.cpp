@@ -1,102 +1,235 @@
 #include "../../includes/Request.hpp"
 
 Request::Request(void)
-    : _method(), _target(), _version(), _headers(),
-      _body(), _parseErrorCode(0), _formData(), _uploadedFiles() {}
-
-Request::Request(const Request &obj): _method(obj._method), _target(obj._target), \
-		_version(obj._version), _headers(obj._headers), _body(obj._body), \
-		_parseErrorCode(obj._parseErrorCode), _formData(obj._formData), _uploadedFiles(obj._uploadedFiles) {}
+    : _source(NULL), _methodSlice(), _targetSlice(), _versionSlice(), _headers(),
+      _method(), _target(), _version(), _lineCopied(false), _body(), _multipart(),
+      _parseErrorCode(0), _formData() {}
+
+Request::Request(const Request &obj): _source(obj._source), _methodSlice(obj._methodSlice), \
+		_targetSlice(obj._targetSlice), _versionSlice(obj._versionSlice), _headers(obj._headers), \
+		_method(obj._method), _target(obj._target), _version(obj._version), \
+		_lineCopied(obj._lineCopied), _body(obj._body), _multipart(obj._multipart), \
+		_parseErrorCode(obj._parseErrorCode), _formData(obj._formData) {}
 Request::~Request(void) {}
 Request &Request::operator=(const Request &obj) 
 {
 	if (this != &obj)
 	{
+		_source = obj._source;
+		_methodSlice = obj._methodSlice;
+		_targetSlice = obj._targetSlice;
+		_versionSlice = obj._versionSlice;
+		_headers = obj._headers;
 		_method = obj._method;
 	 	_target = obj._target;
 		_version = obj._version;
-		_headers = obj._headers;
+		_lineCopied = obj._lineCopied;
 		_body = obj._body;
+		_multipart = obj._multipart;
 		_parseErrorCode = obj._parseErrorCode;
 		_formData = obj._formData;
-		_uploadedFiles = obj._uploadedFiles;
 	}
 	return (*this);
 }
 
-const std::string &Request::getMethod() const { return _method; }
-const std::string &Request::getTarget() const { return _target; }
-const std::string &Request::getVersion() const { return _version; }
-const std::map<std::string, std::string>&Request::getHeaders() const { return _headers; }
-std::string Request::getHeader(const std::string &key) const
+// Prepares for the next request on the connection, keeping allocated capacity
+void Request::reset(void)
 {
-	std::map<std::string, std::string>::const_iterator it = _headers.find(key);
-	if (it != _headers.end())
-		return it->second;
-	return "";
+	_source = NULL;
+	_methodSlice = _targetSlice = _versionSlice = Slice();
+	_headers.clear();
+	_method.clear();
+	_target.clear();
+	_version.clear();
+	_lineCopied = false;
+	_body.reset();
+	_multipart.reset();
+	_parseErrorCode = 0;
+	_formData.clear();
+}
+
+const std::string &Request::getMethod() const { copyRequestLine(); return _method; }
+const std::string &Request::getTarget() const { copyRequestLine(); return _target; }
+const std::string &Request::getVersion() const { copyRequestLine(); return _version; }
+
+// Headers are looked up case-insensitively; the last occurrence wins
+std::string Request::getHeader(const std::string &key) const { return getHeader(key.c_str()); }
+
+std::string Request::getHeader(const char *key) const
+{
+	const HeaderField *field = findHeader(key);
+	if (!field)
+		return "";
+	return std::string(sliceData(field->value), field->value.length);
+}
+
+// Every occurrence of a field, in order, for fields whose repetition matters
+void Request::getHeaderValues(const char *key, std::vector<std::string> &values) const
+{
+	std::size_t length = std::strlen(key);
+	values.clear();
+	for (std::size_t i = 0; i < _headers.size(); ++i)
+	{
+		const HeaderField &field = _headers[i];
+		if (field.name.length == length && strncasecmp(sliceData(field.name), key, length) == 0)
+			values.push_back(std::string(sliceData(field.value), field.value.length));
+	}
+}
+
+const RequestBody &Request::getBody() const { return _body; }
+
+std::size_t Request::getBodySize(void) const
+{
+	return _multipart.isActive() ? _multipart.getReceived() : _body.size();
 }
 
-const std::string &Request::getBody() const { return _body; }
 int Request::getParseErrorCode(void) const { return _parseErrorCode; }
 
 std::string Request::getQueryString(void) const
 {
-	std::string::size_type queryPos = _target.find('?');
+	const std::string &target = getTarget();
+	std::string::size_type queryPos = target.find('?');
 	if (queryPos != std::string::npos)
-		return _target.substr(queryPos + 1);
+		return target.substr(queryPos + 1);
 	return "";
 }
 
-bool	Request::parse(const std::string &raw)
+// HTTP/1.1 connections persist unless the client sends "Connection: close";
+// HTTP/1.0 connections persist only when the client asks for "keep-alive"
+// The header's comma-separated tokens are compared in place
+bool Request::isKeepAlive(void) const
 {
-	std::string::size_type headerEnd = raw.find("\r\n\r\n");
-	if (headerEnd == std::string::npos)
+	bool hasClose = false;
+	bool hasKeepAlive = false;
+	const HeaderField *field = findHeader("connection");
+	if (field)
 	{
-		_parseErrorCode = 400;
-		return false;
+		const char *value = sliceData(field->value);
+		std::size_t length = field->value.length;
+		std::size_t pos = 0;
+		while (pos < length)
+		{
+			while (pos < length && (value[pos] == ' ' || value[pos] == '\t' || value[pos] == ','))
+				++pos;
+			std::size_t start = pos;
+			while (pos < length && value[pos] != ',')
+				++pos;
+			std::size_t end = pos;
+			while (end > start && (value[end - 1] == ' ' || value[end - 1] == '\t'))
+				--end;
+			if (end - start == 5 && strncasecmp(value + start, "close", 5) == 0)
+				hasClose = true;
+			else if (end - start == 10 && strncasecmp(value + start, "keep-alive", 10) == 0)
+				hasKeepAlive = true;
+		}
 	}
-	std::string headers = raw.substr(0, headerEnd);
-	_body = raw.substr(headerEnd + 4);
-	std::istringstream stream(headers);
+	if (hasClose)
+		return false;
+	if (sliceEquals(_versionSlice, "HTTP/1.0"))
+		return hasKeepAlive;
+	return true;
+}
 
-	if (!parseRequestLine(stream))
+void Request::setBodySlice(const Slice &body) { _body.setSlice(*_source, body); }
+
+// Body bytes moved out of the receive buffer: streamed into a multipart upload,
+// or stored in the RequestBody; on failure the error code says why
+bool Request::appendBody(const char *data, std::size_t length)
+{
+	if (_multipart.isActive())
 	{
-		if (_parseErrorCode == 0)
-			_parseErrorCode = 400;
+		if (_multipart.feed(data, length))
+			return true;
+		_parseErrorCode = _multipart.getErrorCode();
 		return false;
 	}
-	if (!parseHeaders(stream))
+	if (_body.append(data, length))
+		return true;
+	_parseErrorCode = 500;
+	return false;
+}
+
+void Request::setBodyBufferSize(std::size_t bufferSize) { _body.setBufferSize(bufferSize); }
+
+// From here on the body is parsed as multipart/form-data while it arrives,
+// with file parts written straight into uploadDir; a form field may take up to
+// client_body_buffer_size in memory, like a body that is not spooled
+bool Request::startMultipartUpload(const std::string &uploadDir)
+{
+	if (_multipart.start(getHeader("content-type"), uploadDir, _body.getBufferSize()))
+		return true;
+	_parseErrorCode = _multipart.getErrorCode();
+	return false;
+}
+
+// A Content-Length body of this length can be left in the receive buffer
+bool Request::keepsBodyInBuffer(std::size_t length) const
+{
+	return !_multipart.isActive() && length <= _body.getBufferSize();
+}
+
+// "METHOD target HTTP/x.y", as located by RequestParser (without its CRLF)
+bool Request::parseRequestLine(const Buffer &source, const Slice &line)
+{
+	_source = &source;
+	const char *data = source.data();
+	Slice *parts[3] = { &_methodSlice, &_targetSlice, &_versionSlice };
+	std::size_t pos = line.offset;
+	std::size_t end = line.offset + line.length;
+	for (int i = 0; i < 3; ++i)
 	{
-		if (_parseErrorCode == 0)
+		while (pos < end && (data[pos] == ' ' || data[pos] == '\t'))
+			++pos;
+		if (pos == end)
+		{
 			_parseErrorCode = 400;
-		return false;
+			return false;
+		}
+		std::size_t start = pos;
+		while (pos < end && data[pos] != ' ' && data[pos] != '\t')
+			++pos;
+		*parts[i] = Slice(start, pos - start);
 	}
-	return true;
+
+	return (checkMethod(_methodSlice) && checkVersion(_versionSlice) && checkTarget(_targetSlice));
 }
 
-bool Request::parseRequestLine(std::istream &stream)
+const char *Request::sliceData(const Slice &slice) const
 {
-	std::string line;
-	if (!std::getline(stream, line))
-	{
-		_parseErrorCode = 400;
-		return false;
-	}
+	return _source ? _source->data() + slice.offset : "";
+}
+
+bool Request::sliceEquals(const Slice &slice, const char *text) const
+{
+	std::size_t length = std::strlen(text);
+	return slice.length == length && std::memcmp(sliceData(slice), text, length) == 0;
+}
 
-	line = trimR(line);
-	std::istringstream requestLine(line);
-	if (!(requestLine >> _method >> _target >> _version))
+const HeaderField *Request::findHeader(const char *key) const
+{
+	std::size_t length = std::strlen(key);
+	for (std::size_t i = _headers.size(); i > 0; --i)
 	{
-		_parseErrorCode = 400;
-		return false;
+		const HeaderField &field = _headers[i - 1];
+		if (field.name.length == length && strncasecmp(sliceData(field.name), key, length) == 0)
+			return &field;
 	}
+	return NULL;
+}
 
-	return (checkMethod(_method) && checkVersion(_version) && checkTarget(_target));
+void Request::copyRequestLine(void) const
+{
+	if (_lineCopied || !_source)
+		return;
+	_method.assign(sliceData(_methodSlice), _methodSlice.length);
+	_target.assign(sliceData(_targetSlice), _targetSlice.length);
+	_version.assign(sliceData(_versionSlice), _versionSlice.length);
+	_lineCopied = true;
 }
 
-bool Request::checkMethod(const std::string &method)
+bool Request::checkMethod(const Slice &method)
 {
-	if (method != "GET" && method != "POST" && method != "DELETE")
+	if (!sliceEquals(method, "GET") && !sliceEquals(method, "POST") && !sliceEquals(method, "DELETE"))
 	{
 		_parseErrorCode = 405;
 		return false;
@@ -104,19 +237,20 @@ bool Request::checkMethod(const std::string &method)
 	return true;
 }
 
-bool Request::checkTarget(const std::string &target)
+bool Request::checkTarget(const Slice &target)
 {
-	if (target.empty() || target[0] != '/')
+	const char *data = sliceData(target);
+	if (target.length == 0 || data[0] != '/')
 	{
 		_parseErrorCode = 400;
 		return false;
 	}
-	if (target.size() > MAX_URI_LENGTH)
+	if (target.length > MAX_URI_LENGTH)
 	{
 		_parseErrorCode = 414;
 		return false;
 	}
-	if (!isValidPercentEncoding(target))
+	if (!isValidPercentEncoding(data, target.length))
 	{
 		_parseErrorCode = 400; // Bad Request for malformed %
 		return false;
@@ -124,15 +258,15 @@ bool Request::checkTarget(const std::string &target)
 	return true;
 }
 
-bool Request::isValidPercentEncoding(const std::string& uri)
+bool Request::isValidPercentEncoding(const char *uri, std::size_t length)
 {
-	for (size_t i = 0; i < uri.length(); ++i)
+	for (size_t i = 0; i < length; ++i)
 	{
 		if (uri[i] == '%')
 		{
-			if (i + 2 >= uri.length() ||
-				!std::isxdigit(uri[i + 1]) ||
-				!std::isxdigit(uri[i + 2]))
+			if (i + 2 >= length ||
+				!std::isxdigit(static_cast<unsigned char>(uri[i + 1])) ||
+				!std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
 			{
 				return false;
 			}
@@ -142,65 +276,78 @@ bool Request::isValidPercentEncoding(const std::string& uri)
 	return true;
 }
 
-bool Request::checkVersion(const std::string &version)
+bool Request::checkVersion(const Slice &version)
 {
-	if (version == "HTTP/1.1" || version == "HTTP/1.0")
+	if (sliceEquals(version, "HTTP/1.1") || sliceEquals(version, "HTTP/1.0"))
 		return true;
 	_parseErrorCode = 426;
 	return false;
 }
 
-bool Request::parseHeaders(std::istream &stream)
+// "Name: value"; the value is recorded without surrounding whitespace
+// Whitespace inside or after the name is refused (RFC 9112 5.1): "Content-Length :"
+// would otherwise be ignored here but honoured by another server on the path
+bool Request::parseHeaderLine(const Buffer &source, const Slice &line)
 {
-	std::string line;
-	while (std::getline(stream, line))
+	_source = &source;
+	const char *data = source.data();
+	const void *colonPtr = std::memchr(data + line.offset, ':', line.length);
+	if (!colonPtr || colonPtr == data + line.offset)
+	{
+		_parseErrorCode = 400;
+		return false;
+	}
+
+	std::size_t colon = static_cast<const char*>(colonPtr) - data;
+	for (std::size_t i = line.offset; i < colon; ++i)
 	{
-		line = trimR(line);
-		std::string::size_type colon = line.find(':');
-		if (colon == std::string::npos)
+		if (data[i] == ' ' || data[i] == '\t')
 		{
 			_parseErrorCode = 400;
 			return false;
 		}
-
-		std::string key = line.substr(0, colon);
-		std::string value = line.substr(colon + 1);
-
-		size_t i = 0;
-		while (i < value.size() && std::isspace(value[i]))
-			++i;
-
-		value = value.substr(i);
-		_headers[::toLower(key)] = value;
 	}
+	std::size_t valueStart = colon + 1;
+	std::size_t valueEnd = line.offset + line.length;
+	while (valueStart < valueEnd && (data[valueStart] == ' ' || data[valueStart] == '\t'))
+		++valueStart;
+	while (valueEnd > valueStart && (data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t'))
+		--valueEnd;
+
+	HeaderField field;
+	field.name = Slice(line.offset, colon - line.offset);
+	field.value = Slice(valueStart, valueEnd - valueStart);
+	_headers.push_back(field);
 	return true;
 }
 
 bool Request::validateBody(std::size_t maxBodySize)
 {
-	if (!isSupportedMethod(_method))
+	if (!isSupportedMethod(getMethod()))
 	{
 		_parseErrorCode = 501;
 		return false;
 	}
 
-	if (!handleChunkedEncoding())
-		return false;
-
 	if (!checkRequiredLengthHeader())
 		return false;
 
 	if (!checkContentLength())
 		return false;
 
+	if (_multipart.isActive() && !_multipart.isComplete())
+	{
+		_parseErrorCode = 400; // the body ended before the closing delimiter
+		return false;
+	}
+
 	if (!checkUploadedFileSizes(maxBodySize))
 		return false;
 
 	if (!checkTotalBodySize(maxBodySize))
 		return false;
 
-	parseBody();
-	return true;
+	return parseBody();
 }
 
 bool Request::isSupportedMethod(const std::string &method)
@@ -214,23 +361,9 @@ bool Request::isSupportedMethod(const std::string &method)
 	return false;
 }
 
-bool Request::handleChunkedEncoding(void)
-{
-	std::string transferEncoding = ::toLower(getHeader("transfer-encoding"));
-	if (transferEncoding == "chunked")
-	{
-		if (!decodeChunkedBody())
-		{
-			_parseErrorCode = 400;
-			return false;
-		}
-	}
-	return true;
-}
-
 bool Request::checkRequiredLengthHeader(void)
 {
-	if (_method == "POST")
+	if (getMethod() == "POST")
 	{
 		std::string cl = getHeader("content-length");
 		std::string te = ::toLower(getHeader("transfer-encoding"));
@@ -258,15 +391,18 @@ bool Request::checkContentLength(void)
 			return false;
 		}
 
-		std::size_t bodySize = _body.size();
+		std::size_t bodySize = getBodySize();
 		if (static_cast<std::size_t>(length) > bodySize)
 		{
 			std::cerr << "Incomplete body: expected " << length << " bytes, got " << bodySize << std::endl;
 			_parseErrorCode = 400;
 			return false;
 		}
-		if (bodySize > static_cast<std::size_t>(length))
-			_body = _body.substr(0, length);
+		if (bodySize > static_cast<std::size_t>(length) && !_body.truncate(length))
+		{
+			_parseErrorCode = 500;
+			return false;
+		}
 	}
 	return true;
 }
@@ -277,14 +413,15 @@ bool Request::checkUploadedFileSizes(std::size_t maxBodySize)
 
 	if (contentType.find("multipart/form-data") != std::string::npos)
 	{
-		for (std::map<std::string, std::vector<UploadedFile> >::const_iterator it = _uploadedFiles.begin();
-		     it != _uploadedFiles.end(); ++it)
+		const std::map<std::string, std::vector<UploadedFile> > &uploadedFiles = getUploadedFiles();
+		for (std::map<std::string, std::vector<UploadedFile> >::const_iterator it = uploadedFiles.begin();
+		     it != uploadedFiles.end(); ++it)
 		{
 			const std::vector<UploadedFile>& fileList = it->second;
 			for (std::vector<UploadedFile>::const_iterator fit = fileList.begin();
 			     fit != fileList.end(); ++fit)
 			{
-				if (fit->content.size() > maxBodySize)
+				if (fit->size > maxBodySize)
 				{
 					_parseErrorCode = 413;
 					return false;
@@ -297,7 +434,7 @@ bool Request::checkUploadedFileSizes(std::size_t maxBodySize)
 
 bool Request::checkTotalBodySize(std::size_t maxBodySize)
 {
-	if (_body.size() > maxBodySize)
+	if (getBodySize() > maxBodySize)
 	{
 		_parseErrorCode = 413;
 		return false;
@@ -305,77 +442,28 @@ bool Request::checkTotalBodySize(std::size_t maxBodySize)
 	return true;
 }
 
-// Checks: 
-//	- Valid hex parsing (returns false otherwise)
-// 	- Check no extra characters after hex
-// 	- Enforce reasonable MAX_CHUNK_SIZE
-// 	- Body ends with chunk terminator ()
-// 	- Next line is same size as chunk size
-// 	- Line ends with \r\n
-//  - Reject chunk extensions ()
-//  - Empty lines (just skip)
-bool Request::decodeChunkedBody()
-{
-	std::string decoded;
-	std::istringstream stream(_body);
-
-	while (true)
-	{
-		std::string line;
-		if (!std::getline(stream, line))
-			return false;
-
-		line = trimR(line);
-		if (line.empty())
-			continue;
-		
-		std::string::size_type semicolon = line.find(';');
-		if (semicolon != std::string::npos)
-			line = line.substr(0, semicolon);
-
-		std::istringstream size(line);
-		std::size_t chunkSize;
-		size >> std::hex >> chunkSize;
-		if (size.fail() || !size.eof())
-			return false;
-		if (chunkSize > MAX_CHUNK_SIZE)
-			return false;
-		
-		if (chunkSize == 0)
-			break;
-		std::string chunk(chunkSize, '\0');
-		stream.read(&chunk[0], chunkSize);
-		if (stream.gcount() != static_cast<std::streamsize>(chunkSize))
-			return false;
-		decoded += chunk;
-
-		char end[2];
-		stream.read(end, 2);
-		if (end[0] != '\r' || end[1] != '\n')
-			return false;
-	}
-	_body = decoded;
-	return true;
-}
-
 const std::map<std::string, std::string>& Request::getFormData() const { return _formData; }
 
 void    Request::printMembers(void) const
 {
 	std::cout << "=== Request Members ===" << std::endl;
-    std::cout << "Method:  " << _method << std::endl;
-    std::cout << "Target:  " << _target << std::endl;
-    std::cout << "Version: " << _version << std::endl;
+    std::cout << "Method:  " << getMethod() << std::endl;
+    std::cout << "Target:  " << getTarget() << std::endl;
+    std::cout << "Version: " << getVersion() << std::endl;
     std::cout << "\n--- Headers ---" << std::endl;
-    for (std::map<std::string, std::string>::const_iterator it = _headers.begin(); it != _headers.end(); ++it) {
-        std::cout << it->first << ": " << it->second << std::endl;
+    for (std::vector<HeaderField>::const_iterator it = _headers.begin(); it != _headers.end(); ++it) {
+        std::cout << std::string(sliceData(it->name), it->name.length) << ": "
+                  << std::string(sliceData(it->value), it->value.length) << std::endl;
     }
 
     std::cout << "\n--- Body ---" << std::endl;
+    std::string body;
     if (_body.empty())
         std::cout << "(no body)" << std::endl;
-    else
-        std::cout << _body << std::endl;
+    else if (_body.isSpooled())
+        std::cout << "(" << _body.size() << " bytes spooled to disk)" << std::endl;
+    else if (BodyReader(_body).readAll(body))
+        std::cout << body << std::endl;
 
     std::cout << "\n--- Form Data ---" << std::endl;
     if (_formData.empty())
@@ -387,16 +475,17 @@ void    Request::printMembers(void) const
         }
     }
 	std::cout << "\n--- Uploaded Files ---" << std::endl;
-	if (_uploadedFiles.empty())
+	const std::map<std::string, std::vector<UploadedFile> > &uploadedFiles = getUploadedFiles();
+	if (uploadedFiles.empty())
 		std::cout << "(no uploaded files)" << std::endl;
 	else
 	{
-		for (std::map<std::string, std::vector<UploadedFile> >::const_iterator it = _uploadedFiles.begin(); it != _uploadedFiles.end(); ++it)
+		for (std::map<std::string, std::vector<UploadedFile> >::const_iterator it = uploadedFiles.begin(); it != uploadedFiles.end(); ++it)
 		{
 			std::cout << "Field: " << it->first << std::endl;
 			for (std::vector<UploadedFile>::const_iterator fit = it->second.begin(); fit != it->second.end(); ++fit)
 			{
-				std::cout << "  Filename: " << fit->filename << ", Size: " << fit->content.size() << " bytes" << std::endl;
+				std::cout << "  Filename: " << fit->filename << ", Size: " << fit->size << " bytes" << std::endl;
 			}
 		}
 	}
@@ -406,15 +495,24 @@ void    Request::printMembers(void) const
 
 const std::map<std::string, std::vector<UploadedFile> >& Request::getUploadedFiles() const 
 {
-	return _uploadedFiles;
+	return _multipart.getFiles();
 }
 
-void Request::parseBody()
+// A form body is parsed as a whole, so it is read into memory; the fields of a
+// multipart upload have already been collected while it streamed in
+// False when a spooled body cannot be read back (500)
+bool Request::parseBody()
 {
     std::string contentType = getHeader("content-type");
     if (contentType.find("application/x-www-form-urlencoded") != std::string::npos)
     {
-        std::istringstream iss(_body);
+        std::string body;
+        if (!BodyReader(_body).readAll(body))
+        {
+            _parseErrorCode = 500;
+            return false;
+        }
+        std::istringstream iss(body);
         std::string pair;
         while (std::getline(iss, pair, '&'))
         {
@@ -427,126 +525,11 @@ void Request::parseBody()
             }
         }
     }
-    else if (contentType.find("multipart/form-data") != std::string::npos)
-    {
-        std::size_t boundaryPos = contentType.find("boundary=");
-		if (boundaryPos == std::string::npos || boundaryPos + 9 >= contentType.length()) {
-			_parseErrorCode = 400;
-			return;
-		}
-		std::string boundary = "--" + contentType.substr(boundaryPos + 9);
-        if (!parseMultipartFormData(boundary))
-			_parseErrorCode = 400;
-    }
-	else if (!contentType.empty())
+    else if (_multipart.isActive())
+        _formData = _multipart.getFields();
+	else if (!contentType.empty() && contentType.find("multipart/form-data") == std::string::npos)
 	{
 		_parseErrorCode = 415;
 	}
-}
-
-bool Request::parseMultipartFormData(const std::string &boundary)
-{
-    std::string::size_type pos = 0;
-    std::string::size_type prevPos = 0;
-
-    // Skip preamble
-    pos = _body.find(boundary, prevPos);
-    if (pos == std::string::npos)
-        return false;
-    prevPos = pos + boundary.length() + 2;
-
-    while (true)
-    {
-        // Find part headers
-        pos = _body.find("\r\n\r\n", prevPos);
-        if (pos == std::string::npos)
-            return false;
-        std::string partHeaders = _body.substr(prevPos, pos - prevPos);
-        prevPos = pos + 4;
-
-        std::string contentDisposition;
-        if (!extractContentDisposition(partHeaders, contentDisposition))
-            return false;
-
-        std::string name, filename;
-        if (!extractFieldNames(contentDisposition, name, filename))
-            return false;
-
-		std::string partContent;
-        std::string::size_type nextBoundaryPos;
-        if (!extractPartContent(prevPos, nextBoundaryPos, boundary, partContent))
-            return false;
-
-        if (!filename.empty())
-		{
-			UploadedFile file;
-			file.filename = filename;
-			file.content = partContent;
-            _uploadedFiles[name].push_back(file);
-		}
-        else if (!name.empty())
-            _formData[name] = partContent;
-        else
-            return false;
-
-        bool isFinal = (_body.substr(nextBoundaryPos, boundary.length() + 4) == boundary + "--\r\n");
-        prevPos = nextBoundaryPos + boundary.length() + (isFinal ? 4 : 2);
-
-        if (isFinal)
-            break;
-    }
-
-    return true;
-}
-
-bool Request::extractContentDisposition(const std::string &headers, std::string &contentDisposition) const
-{
-    std::istringstream stream(headers);
-    std::string line;
-    while (std::getline(stream, line))
-    {
-        if (line.find("Content-Disposition:") != std::string::npos)
-        {
-            contentDisposition = line;
-            return true;
-        }
-    }
-    return false;
-}
-
-bool Request::extractFieldNames(const std::string &contentDisposition, std::string &name, std::string &filename) const
-{
-    std::string::size_type namePos = contentDisposition.find("name=\"");
-    if (namePos != std::string::npos)
-    {
-        namePos += 6;
-        std::string::size_type nameEnd = contentDisposition.find("\"", namePos);
-        if (nameEnd == std::string::npos)
-            return false;
-        name = contentDisposition.substr(namePos, nameEnd - namePos);
-		name = trimR(name);
-    }
-
-    std::string::size_type filenamePos = contentDisposition.find("filename=\"");
-    if (filenamePos != std::string::npos)
-    {
-        filenamePos += 10;
-        std::string::size_type filenameEnd = contentDisposition.find("\"", filenamePos);
-        if (filenameEnd == std::string::npos)
-            return false;
-        filename = contentDisposition.substr(filenamePos, filenameEnd - filenamePos);
-		filename = trimR(filename);
-    }
-
-    return true;
-}
-
-bool Request::extractPartContent(std::string::size_type &prevPos, std::string::size_type &nextBoundaryPos, const std::string &boundary, std::string &partContent) const
-{
-    nextBoundaryPos = _body.find(boundary, prevPos);
-    if (nextBoundaryPos == std::string::npos || nextBoundaryPos < 2 || _body.substr(nextBoundaryPos - 2, 2) != "\r\n")
-        return false;
-
-    partContent = _body.substr(prevPos, nextBoundaryPos - prevPos - 2); // exclude \r\n
-    return true;
+	return true;
 }
@@ -0,0 +1,199 @@
+#include "../../includes/RequestBody.hpp"
+
+// A reused body keeps an in-memory buffer up to this size for the next request
+static const std::size_t MAX_RETAINED_BODY = 64 * 1024;
+
+RequestBody::RequestBody(void)
+	: _source(NULL), _slice(), _memory(), _fd(-1), _size(0), _bufferSize(DEFAULT_CLIENT_BODY_BUFFER_SIZE) {}
+
+// Copies share the temp file through a duplicated descriptor
+RequestBody::RequestBody(const RequestBody &obj)
+	: _source(obj._source), _slice(obj._slice), _memory(obj._memory),
+	  _fd(obj._fd != -1 ? dupCloexec(obj._fd) : -1), _size(obj._size), _bufferSize(obj._bufferSize) {}
+
+RequestBody::~RequestBody(void) { closeFile(); }
+
+RequestBody &RequestBody::operator=(const RequestBody &obj)
+{
+	if (this != &obj)
+	{
+		closeFile();
+		_source = obj._source;
+		_slice = obj._slice;
+		_memory = obj._memory;
+		_fd = (obj._fd != -1) ? dupCloexec(obj._fd) : -1;
+		_size = obj._size;
+		_bufferSize = obj._bufferSize;
+	}
+	return (*this);
+}
+
+std::size_t RequestBody::size(void) const { return _size; }
+
+bool RequestBody::empty(void) const { return _size == 0; }
+
+bool RequestBody::isSpooled(void) const { return _fd != -1; }
+
+std::size_t RequestBody::getBufferSize(void) const { return _bufferSize; }
+
+void RequestBody::setBufferSize(std::size_t bufferSize) { _bufferSize = bufferSize; }
+
+// The body is left where it arrived; valid until the request is consumed from the buffer
+void RequestBody::setSlice(const Buffer &source, const Slice &slice)
+{
+	_source = &source;
+	_slice = slice;
+	_size = slice.length;
+}
+
+// Appends decoded or spooled body bytes, moving the body to a temp file once it
+// outgrows the buffer size; false when the temp file cannot be written
+bool RequestBody::append(const char *data, std::size_t length)
+{
+	if (_source)
+	{
+		_memory.assign(_source->data() + _slice.offset, _slice.length);
+		_source = NULL;
+		_slice = Slice();
+	}
+	if (_fd == -1 && _size + length > _bufferSize && !spill())
+		return false;
+	if (_fd != -1)
+	{
+		if (!writeFile(data, length))
+			return false;
+	}
+	else
+		_memory.append(data, length);
+	_size += length;
+	return true;
+}
+
+// Copies up to length bytes starting at offset; 0 at the end of the body, -1 on error
+ssize_t RequestBody::read(std::size_t offset, char *dst, std::size_t length) const
+{
+	if (offset >= _size)
+		return 0;
+	length = std::min(length, _size - offset);
+	if (_fd != -1)
+	{
+		ssize_t bytesRead;
+		do
+			bytesRead = pread(_fd, dst, length, offset);
+		while (bytesRead < 0 && errno == EINTR);
+		return bytesRead;
+	}
+	const char *data = _source ? _source->data() + _slice.offset : _memory.data();
+	std::memcpy(dst, data + offset, length);
+	return static_cast<ssize_t>(length);
+}
+
+bool RequestBody::truncate(std::size_t length)
+{
+	if (length >= _size)
+		return true;
+	if (_fd != -1 && ftruncate(_fd, length) != 0)
+		return false;
+	if (_source)
+		_slice.length = length;
+	else if (_fd == -1)
+		_memory.resize(length);
+	_size = length;
+	return true;
+}
+
+// Prepares for the next request, dropping the temp file
+void RequestBody::reset(void)
+{
+	closeFile();
+	_source = NULL;
+	_slice = Slice();
+	if (_memory.capacity() > MAX_RETAINED_BODY)
+		std::string().swap(_memory);
+	else
+		_memory.clear();
+	_size = 0;
+	_bufferSize = DEFAULT_CLIENT_BODY_BUFFER_SIZE;
+}
+
+// Moves what is held in memory to a new temp file
+// The file is unlinked straight away, so it disappears with its descriptor
+bool RequestBody::spill(void)
+{
+	char path[] = BODY_TEMP_TEMPLATE;
+	_fd = mkostemp(path, O_CLOEXEC);
+	if (_fd == -1)
+	{
+		errorMsg("Failed to create temp file for request body");
+		return false;
+	}
+	unlink(path);
+	if (!writeFile(_memory.data(), _memory.size()))
+	{
+		closeFile();
+		return false;
+	}
+	std::string().swap(_memory);
+	debugMsg("Request body spooled to disk, FD = ", _fd);
+	return true;
+}
+
+bool RequestBody::writeFile(const char *data, std::size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(_fd, data, length);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			errorMsg("Failed to write request body to temp file");
+			return false;
+		}
+		data += written;
+		length -= written;
+	}
+	return true;
+}
+
+void RequestBody::closeFile(void)
+{
+	if (_fd != -1)
+		close(_fd);
+	_fd = -1;
+}
+
+BodyReader::BodyReader(const RequestBody &body): _body(body), _offset(0) {}
+
+BodyReader::BodyReader(const BodyReader &obj): _body(obj._body), _offset(obj._offset) {}
+
+BodyReader::~BodyReader(void) {}
+
+std::size_t BodyReader::remaining(void) const { return _body.size() - _offset; }
+
+// Next bytes of the body; 0 once it has all been read, -1 on error
+ssize_t BodyReader::read(char *dst, std::size_t length)
+{
+	ssize_t bytesRead = _body.read(_offset, dst, length);
+	if (bytesRead > 0)
+		_offset += bytesRead;
+	return bytesRead;
+}
+
+// Reads the rest of the body into out, for bodies that have to be parsed as a whole
+bool BodyReader::readAll(std::string &out)
+{
+	out.resize(remaining());
+	std::size_t filled = 0;
+	while (filled < out.size())
+	{
+		ssize_t bytesRead = read(&out[filled], out.size() - filled);
+		if (bytesRead <= 0)
+		{
+			out.resize(filled);
+			return false;
+		}
+		filled += bytesRead;
+	}
+	return true;
+}
@@ -0,0 +1,355 @@
+#include "../../includes/RequestParser.hpp"
+
+RequestParser::RequestParser(void)
+	: _state(REQUEST_LINE), _pos(0), _lineStart(0), _bodyStart(0), _remaining(0), _chunked(false),
+	  _spooled(false), _discard(false), _hasLength(false), _contentLength(0), _bodySize(0), _maxBodySize(DEFAULT_MAX_BODY_SIZE), _errorCode(0) {}
+
+RequestParser::RequestParser(const RequestParser &obj)
+	: _state(obj._state), _pos(obj._pos), _lineStart(obj._lineStart), _bodyStart(obj._bodyStart),
+	  _remaining(obj._remaining), _chunked(obj._chunked), _spooled(obj._spooled),
+	  _discard(obj._discard), _hasLength(obj._hasLength), _contentLength(obj._contentLength), _bodySize(obj._bodySize),
+	  _maxBodySize(obj._maxBodySize), _errorCode(obj._errorCode) {}
+
+RequestParser::~RequestParser(void) {}
+
+RequestParser &RequestParser::operator=(const RequestParser &obj)
+{
+	if (this != &obj)
+	{
+		_state = obj._state;
+		_pos = obj._pos;
+		_lineStart = obj._lineStart;
+		_bodyStart = obj._bodyStart;
+		_remaining = obj._remaining;
+		_chunked = obj._chunked;
+		_spooled = obj._spooled;
+		_discard = obj._discard;
+		_hasLength = obj._hasLength;
+		_contentLength = obj._contentLength;
+		_bodySize = obj._bodySize;
+		_maxBodySize = obj._maxBodySize;
+		_errorCode = obj._errorCode;
+	}
+	return (*this);
+}
+
+void RequestParser::setMaxBodySize(std::size_t maxBodySize) { _maxBodySize = maxBodySize; }
+
+// The request has already been answered: its body is read and dropped,
+// never stored, so the connection can go on to the next request
+void RequestParser::discardBody(void)
+{
+	_discard = true;
+	_spooled = true;
+}
+
+int RequestParser::getErrorCode(void) const { return _errorCode; }
+
+// Bytes the complete request occupies at the front of the buffer
+std::size_t RequestParser::getRequestLength(void) const { return _pos; }
+
+// The header is complete and the body is still arriving
+bool RequestParser::inBody(void) const { return _state >= BODY && _state < DONE; }
+
+// The header framed a body, possibly an empty one
+bool RequestParser::hasBodyLength(void) const { return _hasLength; }
+
+bool RequestParser::isChunked(void) const { return _chunked; }
+
+// Declared Content-Length; 0 for a chunked body
+std::size_t RequestParser::getContentLength(void) const { return _contentLength; }
+
+bool RequestParser::discardsBody(void) const { return _discard; }
+
+void RequestParser::reset(void) { *this = RequestParser(); }
+
+// Advances through whatever has arrived since the last call
+RequestParser::Status RequestParser::parse(Buffer &input, Request &request)
+{
+	Slice line;
+	Status status = PARSE_COMPLETE;
+
+	while (_state != DONE && status != PARSE_INCOMPLETE)
+	{
+		switch (_state)
+		{
+			case REQUEST_LINE:
+				if (!nextLine(input, line))
+				{
+					if (_pos - _lineStart > MAX_REQUEST_LINE)
+						return fail(414);
+					return PARSE_INCOMPLETE;
+				}
+				if (line.length == 0)
+				{
+					// stray CRLF before the request, as allowed by RFC 9112; the
+					// bytes stay in the buffer, so only a line's worth is accepted
+					if (_pos > MAX_REQUEST_LINE)
+						return fail(400);
+					break;
+				}
+				if (!request.parseRequestLine(input, line))
+					return fail(request.getParseErrorCode());
+				_state = HEADER_LINE;
+				break;
+
+			case HEADER_LINE:
+				if (!nextLine(input, line))
+				{
+					if (_pos > MAX_HEADER_SIZE)
+						return fail(431);
+					return PARSE_INCOMPLETE;
+				}
+				if (_pos > MAX_HEADER_SIZE)
+					return fail(431);
+				if (line.length == 0)
+				{
+					if (!startBody(request))
+						return fail(_errorCode);
+					return PARSE_HEADERS_COMPLETE;
+				}
+				else if (!request.parseHeaderLine(input, line))
+					return fail(request.getParseErrorCode());
+				break;
+
+			case BODY:
+			{
+				if (!_spooled && _pos == _bodyStart) // first bytes of the body
+				{
+					if (_remaining > _maxBodySize)
+						return fail(413);
+					_spooled = !request.keepsBodyInBuffer(_remaining);
+				}
+				std::size_t take = std::min(input.size() - _pos, _remaining);
+				if (_spooled && !_discard && !request.appendBody(input.data() + _pos, take))
+					return fail(request.getParseErrorCode());
+				_pos += take;
+				if (_spooled)
+					_lineStart = _pos;
+				_remaining -= take;
+				if (_remaining > 0)
+					status = PARSE_INCOMPLETE;
+				else
+					_state = DONE;
+				break;
+			}
+
+			case CHUNK_DATA:
+			{
+				std::size_t take = std::min(input.size() - _pos, _remaining);
+				if (!_discard && !request.appendBody(input.data() + _pos, take))
+					return fail(request.getParseErrorCode());
+				_pos += take;
+				_lineStart = _pos;
+				_remaining -= take;
+				if (_remaining == 0)
+					_state = CHUNK_DATA_END;
+				else
+					status = PARSE_INCOMPLETE;
+				break;
+			}
+
+			case CHUNK_DATA_END:
+				if (input.size() - _pos >= 2)
+				{
+					if (input.data()[_pos] != '\r' || input.data()[_pos + 1] != '\n')
+						return fail(400);
+					_pos += 2;
+					_lineStart = _pos;
+					_state = CHUNK_SIZE;
+				}
+				else
+					status = PARSE_INCOMPLETE;
+				break;
+
+			case CHUNK_SIZE:
+				if (!nextLine(input, line))
+				{
+					if (_pos - _lineStart > MAX_REQUEST_LINE)
+						return fail(400);
+					status = PARSE_INCOMPLETE;
+					break;
+				}
+				if (!parseChunkSize(input, line))
+					return fail(400);
+				if (_remaining > _maxBodySize - _bodySize)
+					return fail(413);
+				_bodySize += _remaining;
+				_state = (_remaining == 0) ? CHUNK_TRAILER : CHUNK_DATA;
+				break;
+
+			case CHUNK_TRAILER:
+				if (!nextLine(input, line))
+				{
+					if (_pos - _lineStart > MAX_REQUEST_LINE)
+						return fail(400);
+					status = PARSE_INCOMPLETE;
+				}
+				else if (line.length == 0)
+					_state = DONE;
+				break;
+
+			case DONE:
+				break;
+		}
+	}
+	if (_chunked || _spooled)
+		discardDecoded(input);
+	else if (_state == DONE && _bodyStart < _pos)
+		request.setBodySlice(Slice(_bodyStart, _pos - _bodyStart));
+	return status;
+}
+
+// Drops the body bytes already decoded or spooled into the Request, keeping any
+// partial line and the bytes after it; the header stays in front of the body
+void RequestParser::discardDecoded(Buffer &input)
+{
+	std::size_t decoded = _lineStart - _bodyStart;
+	if (decoded == 0)
+		return;
+	input.erase(_bodyStart, decoded);
+	_pos -= decoded;
+	_lineStart = _bodyStart;
+}
+
+// Finds the end of the current line, scanning only bytes not seen before
+// The line is located without its CRLF (a bare LF is accepted too)
+bool RequestParser::nextLine(const Buffer &input, Slice &line)
+{
+	const char *data = input.data();
+	const void *newline = std::memchr(data + _pos, '\n', input.size() - _pos);
+	if (!newline)
+	{
+		_pos = input.size();
+		return false;
+	}
+	std::size_t end = static_cast<const char*>(newline) - data;
+	_pos = end + 1;
+	if (end > _lineStart && data[end - 1] == '\r')
+		--end;
+	line = Slice(_lineStart, end - _lineStart);
+	_lineStart = _pos;
+	return true;
+}
+
+// The header is complete: decides how the body is framed (RFC 9112 6.3)
+// On a persistent connection a body framed otherwise than the client meant is
+// read as the next request, so anything ambiguous is refused:
+// - Transfer-Encoding must end with chunked (400), and no other coding is
+//   supported (501)
+// - Content-Length must be digits only, the same in every occurrence (400)
+// - both at once are refused too (400), as NGINX does
+bool RequestParser::startBody(Request &request)
+{
+	_bodyStart = _pos;
+	std::vector<std::string> transferEncodings;
+	std::vector<std::string> contentLengths;
+	request.getHeaderValues("transfer-encoding", transferEncodings);
+	request.getHeaderValues("content-length", contentLengths);
+	if (!transferEncodings.empty())
+	{
+		if (!contentLengths.empty() || !checkTransferEncoding(transferEncodings))
+			return false;
+		_chunked = true;
+		_hasLength = true;
+		_state = CHUNK_SIZE;
+		return true;
+	}
+	if (!contentLengths.empty())
+	{
+		if (!parseContentLength(contentLengths))
+			return false;
+		_hasLength = true;
+		_state = (_remaining > 0) ? BODY : DONE;
+		return true;
+	}
+	_state = DONE;
+	return true;
+}
+
+// The codings of every Transfer-Encoding field, in order, must be exactly "chunked"
+bool RequestParser::checkTransferEncoding(const std::vector<std::string> &values)
+{
+	std::vector<std::string> codings;
+	for (std::size_t i = 0; i < values.size(); ++i)
+	{
+		std::string::size_type start = 0;
+		while (true)
+		{
+			std::string::size_type comma = values[i].find(',', start);
+			std::string coding = values[i].substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+			std::string::size_type first = coding.find_first_not_of(" \t");
+			std::string::size_type last = coding.find_last_not_of(" \t");
+			codings.push_back(first == std::string::npos ? "" : ::toLower(coding.substr(first, last - first + 1)));
+			if (comma == std::string::npos)
+				break;
+			start = comma + 1;
+		}
+	}
+	_errorCode = 400;
+	if (codings.back() != "chunked")
+		return false;
+	for (std::size_t i = 0; i + 1 < codings.size(); ++i)
+	{
+		if (codings[i].empty() || codings[i] == "chunked")
+			return false;
+	}
+	if (codings.size() > 1)
+	{
+		_errorCode = 501; // e.g. gzip, chunked: well-formed, but not decoded here
+		return false;
+	}
+	_errorCode = 0;
+	return true;
+}
+
+// 1*DIGIT, without sign or whitespace, and small enough to be a size
+bool RequestParser::parseContentLength(const std::vector<std::string> &values)
+{
+	_errorCode = 400;
+	for (std::size_t i = 0; i < values.size(); ++i)
+	{
+		if (values[i].empty() || values[i].size() > MAX_CONTENT_LENGTH_DIGITS || values[i] != values[0])
+			return false;
+		for (std::size_t j = 0; j < values[i].size(); ++j)
+		{
+			if (!std::isdigit(static_cast<unsigned char>(values[i][j])))
+				return false;
+		}
+	}
+	_errorCode = 0;
+	_remaining = 0;
+	for (std::size_t j = 0; j < values[0].size(); ++j)
+		_remaining = _remaining * 10 + (values[0][j] - '0');
+	_contentLength = _remaining;
+	return true;
+}
+
+// Hex chunk size, optionally followed by chunk extensions, which are ignored
+bool RequestParser::parseChunkSize(const Buffer &input, const Slice &line)
+{
+	const char *data = input.data() + line.offset;
+	std::size_t i = 0;
+	unsigned long chunkSize = 0;
+	for (; i < line.length && std::isxdigit(static_cast<unsigned char>(data[i])); ++i)
+	{
+		int digit = std::isdigit(static_cast<unsigned char>(data[i])) ? data[i] - '0' : (std::tolower(data[i]) - 'a' + 10);
+		chunkSize = chunkSize * 16 + digit;
+		if (chunkSize > MAX_CHUNK_SIZE)
+			return false;
+	}
+	if (i == 0)
+		return false;
+	while (i < line.length && (data[i] == ' ' || data[i] == '\t'))
+		++i;
+	if (i < line.length && data[i] != ';')
+		return false;
+	_remaining = chunkSize;
+	return true;
+}
+
+RequestParser::Status RequestParser::fail(int code)
+{
+	_errorCode = code ? code : 400;
+	return PARSE_ERROR;
+}
@@ -1,75 +1,165 @@
 #include "../../includes/ServerConfig.hpp"
 #include "../../includes/Response.hpp"
 
-static std::string normalizeHeaderKey(const std::string &key)
+// Status lines for every code from 100 to 599, rendered once
+static const int FIRST_STATUS = 100;
+static const int LAST_STATUS = 599;
+
+static std::vector<std::string> createStatusLines()
+{
+	std::vector<std::string> lines;
+	for (int code = FIRST_STATUS; code <= LAST_STATUS; ++code)
+		lines.push_back("HTTP/1.1 " + ::toString(code) + " " + httpStatusMessage(code) + "\r\n");
+	return lines;
+}
+
+static const std::vector<std::string> statusLines = createStatusLines();
+
+// Header names are stored as Content-Type, Last-Modified, ...; a name that is
+// already in that form is left untouched
+static void normalizeHeaderKey(std::string &key)
 {
-	std::string result;
 	bool capitalizeNext = true;
-	for (std::string::const_iterator it = key.begin(); it != key.end(); ++it)
+	for (std::string::size_type i = 0; i < key.size(); ++i)
 	{
-		if (*it == '-')
-		{
-			result += *it;
-			capitalizeNext = true;
-		}
-		else if (capitalizeNext)
-		{
-			result += std::toupper(*it);
-			capitalizeNext = false;
-		}
-		else
-			result += std::tolower(*it);
+		char c = key[i];
+		char wanted = capitalizeNext ? std::toupper(c) : std::tolower(c);
+		if (c != wanted)
+			key[i] = wanted;
+		capitalizeNext = (c == '-');
+	}
+}
+
+// Decimal digits of n, written backwards from end; returns where they start
+static char *formatNumber(char *end, std::size_t n)
+{
+	do
+	{
+		*--end = static_cast<char>('0' + n % 10);
+		n /= 10;
 	}
-	return result;
+	while (n > 0);
+	return end;
+}
+
+static char *appendBytes(char *dst, const std::string &s)
+{
+	std::memcpy(dst, s.data(), s.size());
+	return dst + s.size();
 }
 
-Response::Response(void): _httpVersion("HTTP/1.1"), _statusCode(200) {}
+static const std::size_t NUMBER_BUFFER_SIZE = 24; // any size_t in decimal
 
-Response::Response(const Response &obj): _httpVersion(obj._httpVersion), _statusCode(obj._statusCode), _statusLine(obj._statusLine), _headers(obj._headers), _body(obj._body) {}
+Response::Response(void): _statusCode(200), _headerCount(0), _rendered(NULL), _renderedHeaderLength(0) {}
 
-Response::~Response(void) {}
+// Copies share the file body through a duplicated descriptor, and a rendered response
+Response::Response(const Response &obj): _statusCode(200), _headerCount(0), _rendered(NULL), _renderedHeaderLength(0)
+{
+	copyFrom(obj);
+}
+
+Response::~Response(void)
+{
+	closeFile();
+	dropRendered();
+}
 
 Response &Response::operator=(const Response &obj) 
 {
 	if (this != &obj)
 	{
-		_httpVersion = obj._httpVersion;
-		_statusCode = obj._statusCode;
-		_statusLine = obj._statusLine;
-		_headers = obj._headers;
-		_body = obj._body;
+		closeFile();
+		dropRendered();
+		copyFrom(obj);
 	}
 	return (*this);
 }
 
-void    Response::setStatusLine(int code, const std::string &message)
+void Response::copyFrom(const Response &obj)
+{
+	_statusCode = obj._statusCode;
+	_customStatusLine = obj._customStatusLine;
+	for (std::size_t i = 0; i < INLINE_HEADERS; ++i)
+		_inlineHeaders[i] = obj._inlineHeaders[i];
+	_extraHeaders = obj._extraHeaders;
+	_headerCount = obj._headerCount;
+	_body = obj._body;
+	_file = obj._file;
+	if (_file.fd != -1)
+		_file.fd = dupCloexec(_file.fd);
+	_parts = obj._parts;
+	for (std::size_t i = 0; i < _parts.size(); ++i)
+	{
+		if (_parts[i].file.fd != -1)
+			_parts[i].file.fd = dupCloexec(_parts[i].file.fd);
+	}
+	_rendered = obj._rendered;
+	_renderedHeaderLength = obj._renderedHeaderLength;
+	if (_rendered)
+		_rendered->retain();
+}
+
+ResponseHeader &Response::headerAt(std::size_t i)
+{
+	return (i < INLINE_HEADERS) ? _inlineHeaders[i] : _extraHeaders[i - INLINE_HEADERS];
+}
+
+const ResponseHeader &Response::headerAt(std::size_t i) const
+{
+	return (i < INLINE_HEADERS) ? _inlineHeaders[i] : _extraHeaders[i - INLINE_HEADERS];
+}
+
+// Standard reason phrase for the code
+void Response::setStatus(int code)
 {
-	std::ostringstream	line;
-	line << _httpVersion << " " << code << " " << message;
 	_statusCode = code;
-	_statusLine = line.str();
+	if (code >= FIRST_STATUS && code <= LAST_STATUS)
+		_customStatusLine.clear();
+	else
+		_customStatusLine = "HTTP/1.1 " + ::toString(code) + " " + httpStatusMessage(code) + "\r\n";
 }
 
+void    Response::setStatusLine(int code, const std::string &message)
+{
+	setStatus(code);
+	if (_customStatusLine.empty() && message != httpStatusMessage(code))
+		_customStatusLine = "HTTP/1.1 " + ::toString(code) + " " + message + "\r\n";
+}
+
+// Replaces the value of a field already set, whatever the case of its name
+// Content-Length is ignored: it is computed from the body when serialized
 void    Response::setHeader(const std::string &key, const std::string &value)
 {
-	_headers[normalizeHeaderKey(key)] = value;
+	if (strcasecmp(key.c_str(), "Content-Length") == 0)
+		return;
+	for (std::size_t i = 0; i < _headerCount; ++i)
+	{
+		ResponseHeader &field = headerAt(i);
+		if (field.name.size() == key.size() && strcasecmp(field.name.c_str(), key.c_str()) == 0)
+		{
+			field.value = value;
+			return;
+		}
+	}
+	if (_headerCount >= INLINE_HEADERS)
+		_extraHeaders.push_back(ResponseHeader());
+	ResponseHeader &field = headerAt(_headerCount++);
+	field.name = key;
+	normalizeHeaderKey(field.name);
+	field.value = value;
 }
 
 void Response::setBody(const std::string &body)
 {
+	closeFile();
+	dropRendered();
 	_body = body;
-	std::istringstream iss(_statusLine);
-	std::string version;
-	int code;
-	iss >> version >> code;
-	if (code != 204 && code != 304 && (code < 100 || code >= 200))
-		setHeader("Content-Length", ::toString(_body.size()));
 }
 
 void Response::setError(int code, const ServerConfig &config)
 {
 	std::string message = httpStatusMessage(code);
-	setStatusLine(code, message);
+	setStatus(code);
 	setHeader("Content-Type", "text/html");
 
 	std::map<int, std::string>::const_iterator it = config.getErrorPages().find(code);
@@ -110,46 +200,278 @@ void Response::setDefaultErrorBody(int code, const std::string &message)
 
 void Response::setFile(const std::string &body, const std::string &mimeType)
 {
-	setStatusLine(200, httpStatusMessage(200));
+	setStatus(200);
 	setHeader("Content-Type", mimeType);
 	setBody(body);
 }
 
-// Code 204 and 304 don't include message body and no content-length header
-std::string Response::toString(void) const
+// Serves size bytes of an open file; the response takes ownership of fd
+void Response::setFile(int fd, std::size_t size, const std::string &mimeType)
+{
+	setStatus(200);
+	setHeader("Content-Type", mimeType);
+	setFileBody(fd, 0, size);
+}
+
+// The body is length bytes of fd from offset; the response takes ownership of fd
+void Response::setFileBody(int fd, off_t offset, std::size_t length)
 {
-	std::ostringstream oss;
-	oss << _statusLine << "\r\n";
+	closeFile();
+	dropRendered();
+	_body.clear();
+	_file.fd = fd;
+	_file.offset = offset;
+	_file.length = length;
+}
 
-	// Extract status code
-	std::istringstream iss(_statusLine);
-	std::string httpVersion;
-	int code = 0;
-	iss >> httpVersion >> code;
+// The whole response is in rendered, header first; the response holds a reference to it
+void Response::setRendered(SharedBuffer *rendered, std::size_t headerLength)
+{
+	closeFile();
+	dropRendered();
+	_body.clear();
+	rendered->retain();
+	_rendered = rendered;
+	_renderedHeaderLength = headerLength;
+}
 
-	// Suppress Content-Length and body for 204 and 304
-	if (code == 204 || code == 304)
+// Appends bytes to a body sent as parts
+void Response::addBodyPart(const std::string &data)
+{
+	if (_parts.empty())
 	{
-		// Remove Content-Length and any related headers
-		for (std::map<std::string, std::string>::const_iterator it = _headers.begin(); it != _headers.end(); ++it)
-		{
-			if (it->first != "Content-Length")
-				oss << it->first << ": " << it->second << "\r\n";
-		}
-		oss << "\r\n"; // End of headers
+		closeFile();
+		dropRendered();
+		_body.clear();
 	}
-	else
+	_parts.push_back(BodyPart());
+	_parts.back().data = data;
+}
+
+// Appends length bytes of fd from offset to a body sent as parts; the response
+// takes ownership of fd
+void Response::addFileBodyPart(int fd, off_t offset, std::size_t length)
+{
+	if (_parts.empty())
 	{
-		for (std::map<std::string, std::string>::const_iterator it = _headers.begin(); it != _headers.end(); ++it)
-		{
-			oss << it->first << ": " << it->second << "\r\n";
-		}
-		oss << "\r\n" << _body;
+		closeFile();
+		dropRendered();
+		_body.clear();
 	}
-	return oss.str();
+	_parts.push_back(BodyPart());
+	_parts.back().file.fd = fd;
+	_parts.back().file.offset = offset;
+	_parts.back().file.length = length;
+}
+
+const std::string &Response::statusLine(void) const
+{
+	if (!_customStatusLine.empty())
+		return _customStatusLine;
+	return statusLines[_statusCode - FIRST_STATUS];
+}
+
+// 1xx, 204 and 304 responses have no body, so no Content-Length either
+bool Response::hasContentLength(void) const
+{
+	return _statusCode >= 200 && _statusCode != 204 && _statusCode != 304;
+}
+
+std::size_t Response::bodySize(void) const
+{
+	if (!_parts.empty())
+	{
+		std::size_t size = 0;
+		for (std::size_t i = 0; i < _parts.size(); ++i)
+			size += (_parts[i].file.fd != -1) ? _parts[i].file.length : _parts[i].data.size();
+		return size;
+	}
+	return (_file.fd != -1) ? _file.length : _body.size();
+}
+
+// Exact length of the serialized header, blank line included
+std::size_t Response::headerSize(void) const
+{
+	std::size_t size = statusLine().size() + fieldsSize() + 2;
+	if (hasContentLength())
+	{
+		char number[NUMBER_BUFFER_SIZE];
+		char *end = number + sizeof(number);
+		size += std::strlen("Content-Length: ") + (end - formatNumber(end, bodySize())) + 2;
+	}
+	return size;
+}
+
+// Length of the header fields set, without status line, Content-Length or blank line
+std::size_t Response::fieldsSize(void) const
+{
+	std::size_t size = 0;
+	for (std::size_t i = 0; i < _headerCount; ++i)
+		size += headerAt(i).name.size() + 2 + headerAt(i).value.size() + 2;
+	return size;
+}
+
+// Writes the status line and header fields, up to the blank line ending them,
+// to dst, which must have room for headerSize() bytes; returns the end
+char *Response::serializeHeader(char *dst) const
+{
+	dst = appendBytes(dst, statusLine());
+	dst = serializeFields(dst);
+	if (hasContentLength())
+	{
+		static const char prefix[] = "Content-Length: ";
+		std::memcpy(dst, prefix, sizeof(prefix) - 1);
+		dst += sizeof(prefix) - 1;
+		char number[NUMBER_BUFFER_SIZE];
+		char *end = number + sizeof(number);
+		char *start = formatNumber(end, bodySize());
+		std::memcpy(dst, start, end - start);
+		dst += end - start;
+		*dst++ = '\r';
+		*dst++ = '\n';
+	}
+	*dst++ = '\r';
+	*dst++ = '\n';
+	return dst;
+}
+
+// Writes the header fields set to dst, which must have room for fieldsSize()
+// bytes; returns the end
+// A rendered response is sent with these spliced in after its own fields
+char *Response::serializeFields(char *dst) const
+{
+	for (std::size_t i = 0; i < _headerCount; ++i)
+	{
+		const ResponseHeader &field = headerAt(i);
+		dst = appendBytes(dst, field.name);
+		*dst++ = ':';
+		*dst++ = ' ';
+		dst = appendBytes(dst, field.value);
+		*dst++ = '\r';
+		*dst++ = '\n';
+	}
+	return dst;
+}
+
+// Hands the string body over to the caller without copying it; 204 and 304
+// responses have none
+void Response::releaseBody(std::string &out)
+{
+	out.clear();
+	if (_statusCode != 204 && _statusCode != 304)
+		out.swap(_body);
 }
 
 bool Response::isError() const
 {
 	return _statusCode >= 400;
 }
+
+// Sets the location's expires and add_header fields (like in NGINX): only on
+// 200, 201, 204, 206, 301, 302, 303, 304, 307 and 308, but for add_header ... always
+// A rendered response gets them when sent, so cached ones stay shared
+void Response::applyCachePolicy(const Route &route)
+{
+	static const int statuses[] = {200, 201, 204, 206, 301, 302, 303, 304, 307, 308};
+	bool cacheable = false;
+	for (std::size_t i = 0; i < sizeof(statuses) / sizeof(statuses[0]); ++i)
+		cacheable = cacheable || _statusCode == statuses[i];
+
+	if (cacheable && route.getExpiresPolicy() != EXPIRES_OFF)
+	{
+		std::string cacheControl;
+		if (route.getExpiresPolicy() == EXPIRES_EPOCH)
+		{
+			setHeader("Expires", "Thu, 01 Jan 1970 00:00:01 GMT");
+			cacheControl = "no-cache";
+		}
+		else if (route.getExpiresPolicy() == EXPIRES_MAX)
+		{
+			setHeader("Expires", "Thu, 31 Dec 2037 23:55:55 GMT");
+			cacheControl = "max-age=315360000";
+		}
+		else
+		{
+			long seconds = route.getExpiresSeconds();
+			setHeader("Expires", httpDate(time(NULL) + seconds));
+			std::ostringstream maxAge;
+			maxAge << "max-age=" << seconds;
+			cacheControl = (seconds < 0) ? "no-cache" : maxAge.str();
+		}
+		if (route.isExpiresImmutable() && cacheControl != "no-cache")
+			cacheControl += ", immutable";
+		setHeader("Cache-Control", cacheControl);
+	}
+	const std::vector<AddedHeader> &added = route.getAddedHeaders();
+	for (std::size_t i = 0; i < added.size(); ++i)
+		if (cacheable || added[i].always)
+			setHeader(added[i].name, added[i].value);
+}
+
+int Response::getStatusCode(void) const { return _statusCode; }
+
+// Value of a field, whatever the case of its name; empty when it is not set
+std::string Response::getHeader(const std::string &key) const
+{
+	for (std::size_t i = 0; i < _headerCount; ++i)
+	{
+		const ResponseHeader &field = headerAt(i);
+		if (field.name.size() == key.size() && strcasecmp(field.name.c_str(), key.c_str()) == 0)
+			return field.value;
+	}
+	return "";
+}
+
+const std::string &Response::getBody(void) const { return _body; }
+
+// Whether the body is held as a string, rather than a file, parts or a rendered response
+bool Response::hasStringBody(void) const
+{
+	return _file.fd == -1 && _parts.empty() && !_rendered;
+}
+
+bool Response::hasFile(void) const { return _file.fd != -1; }
+
+// Hands the file body over to the caller, which then has to close it;
+// serializeHeader() still announces its length
+FileRange Response::releaseFile(void)
+{
+	FileRange file = _file;
+	_file = FileRange();
+	return file;
+}
+
+bool Response::hasParts(void) const { return !_parts.empty(); }
+
+// Hands the body parts over to the caller, which then has to close their files
+void Response::releaseParts(std::vector<BodyPart> &out)
+{
+	out.clear();
+	out.swap(_parts);
+}
+
+SharedBuffer *Response::getRendered(void) const { return _rendered; }
+
+std::size_t Response::getRenderedHeaderLength(void) const { return _renderedHeaderLength; }
+
+void Response::dropRendered(void)
+{
+	if (_rendered)
+		_rendered->release();
+	_rendered = NULL;
+	_renderedHeaderLength = 0;
+}
+
+// Drops a file body, whole or in parts
+void Response::closeFile(void)
+{
+	if (_file.fd != -1)
+		close(_file.fd);
+	_file = FileRange();
+	for (std::size_t i = 0; i < _parts.size(); ++i)
+	{
+		if (_parts[i].file.fd != -1)
+			close(_parts[i].file.fd);
+	}
+	_parts.clear();
+}
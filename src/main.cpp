@@ -7,9 +7,12 @@
 #include "../includes/StaticFileHandler.hpp"
 #include "../includes/Server.hpp"
 #include "../includes/ServerManager.hpp"
+#include "../includes/WorkerPool.hpp"
 
 int	main(int argc, char **argv)
 {
+	// A client resetting mid-response must surface as EPIPE, not kill the server
+	signal(SIGPIPE, SIG_IGN);
 	try
 	{
 		if (argc > 2)
@@ -19,9 +22,9 @@ int	main(int argc, char **argv)
 		ConfigParser parser(configFile);
 		parser.parse();
 		std::vector<ServerConfig> configs = parser.getServers();
-		ServerManager manager(configs);
-		manager.setup();
-		manager.start();
+		WorkerPool workers(configs, parser.getWorkerThreads(), parser.getWorkerProcesses(), parser.getCpuAffinity());
+		workers.setup();
+		workers.start();
 	}
 	catch (std::exception &e)
 	{
@@ -0,0 +1,196 @@
+#include "../../includes/Buffer.hpp"
+
+// Smallest size class; classes grow by 4x up to 1 MB
+static const std::size_t MIN_BUFFER_SIZE = 4 * 1024;
+// Free blocks kept per size class; the large classes keep fewer
+static const std::size_t POOL_LIMITS[] = { 256, 64, 16, 8, 4 };
+
+BufferPool::BufferPool(void) {}
+
+BufferPool::~BufferPool(void)
+{
+	for (int c = 0; c < CLASSES; ++c)
+		for (std::size_t i = 0; i < _free[c].size(); ++i)
+			delete[] _free[c][i];
+}
+
+// Size class holding at least size bytes; -1 when larger than every class
+int BufferPool::classOf(std::size_t size)
+{
+	std::size_t classSize = MIN_BUFFER_SIZE;
+	for (int c = 0; c < CLASSES; ++c, classSize *= 4)
+		if (size <= classSize)
+			return c;
+	return -1;
+}
+
+char *BufferPool::get(std::size_t minSize, std::size_t &capacity)
+{
+	int c = classOf(minSize);
+	if (c < 0)
+	{
+		capacity = minSize;
+		return new char[capacity];
+	}
+	capacity = MIN_BUFFER_SIZE << (2 * c);
+	if (_free[c].empty())
+		return new char[capacity];
+	char *data = _free[c].back();
+	_free[c].pop_back();
+	return data;
+}
+
+void BufferPool::put(char *data, std::size_t capacity)
+{
+	int c = classOf(capacity);
+	if (c < 0 || (MIN_BUFFER_SIZE << (2 * c)) != capacity || _free[c].size() >= POOL_LIMITS[c])
+	{
+		delete[] data;
+		return;
+	}
+	_free[c].push_back(data);
+}
+
+Buffer::Buffer(void): _data(NULL), _capacity(0), _start(0), _end(0), _pool(NULL) {}
+
+Buffer::Buffer(const Buffer &obj): _data(NULL), _capacity(0), _start(0), _end(0), _pool(obj._pool)
+{
+	append(obj.data(), obj.size());
+}
+
+Buffer::~Buffer(void) { release(); }
+
+Buffer &Buffer::operator=(const Buffer &obj)
+{
+	if (this != &obj)
+	{
+		clear();
+		append(obj.data(), obj.size());
+	}
+	return *this;
+}
+
+// Storage already held keeps coming from (and returns to) the allocator it came from
+void Buffer::setPool(BufferPool *pool)
+{
+	if (_pool != pool)
+		release();
+	_pool = pool;
+}
+
+const char *Buffer::data(void) const { return _data + _start; }
+std::size_t Buffer::size(void) const { return _end - _start; }
+bool Buffer::empty(void) const { return _end == _start; }
+std::size_t Buffer::capacity(void) const { return _capacity; }
+char *Buffer::writePtr(void) { return _data + _end; }
+std::size_t Buffer::writable(void) const { return _capacity - _end; }
+
+// Makes room for at least n more bytes at the tail: consumed space at the head
+// is reclaimed first, otherwise the storage at least doubles
+void Buffer::reserve(std::size_t n)
+{
+	if (writable() >= n)
+		return;
+	std::size_t used = size();
+	if (_capacity - used >= n && used <= _capacity / 2)
+	{
+		std::memmove(_data, _data + _start, used);
+		_start = 0;
+		_end = used;
+		return;
+	}
+	std::size_t wanted = std::max(used + n, _capacity * 2);
+	std::size_t newCapacity;
+	char *newData;
+	if (_pool)
+		newData = _pool->get(wanted, newCapacity);
+	else
+	{
+		newCapacity = std::max(wanted, MIN_BUFFER_SIZE);
+		newData = new char[newCapacity];
+	}
+	if (used)
+		std::memcpy(newData, _data + _start, used);
+	char *oldData = _data;
+	std::size_t oldCapacity = _capacity;
+	_data = newData;
+	_capacity = newCapacity;
+	_start = 0;
+	_end = used;
+	if (oldData)
+	{
+		if (_pool)
+			_pool->put(oldData, oldCapacity);
+		else
+			delete[] oldData;
+	}
+}
+
+// Accounts for n bytes written at writePtr()
+void Buffer::commit(std::size_t n) { _end += std::min(n, writable()); }
+
+void Buffer::append(const char *bytes, std::size_t n)
+{
+	if (n == 0)
+		return;
+	reserve(n);
+	std::memcpy(_data + _end, bytes, n);
+	_end += n;
+}
+
+void Buffer::consume(std::size_t n)
+{
+	_start += std::min(n, size());
+	if (_start == _end)
+		_start = _end = 0;
+}
+
+// Removes n bytes from the middle; only the bytes after them are moved
+void Buffer::erase(std::size_t pos, std::size_t n)
+{
+	if (pos >= size())
+		return;
+	n = std::min(n, size() - pos);
+	if (pos == 0)
+	{
+		consume(n);
+		return;
+	}
+	char *at = _data + _start + pos;
+	std::memmove(at, at + n, size() - pos - n);
+	_end -= n;
+}
+
+void Buffer::clear(void) { _start = _end = 0; }
+
+// Hands the storage back; the next write starts again from the smallest size
+void Buffer::release(void)
+{
+	if (_data)
+	{
+		if (_pool)
+			_pool->put(_data, _capacity);
+		else
+			delete[] _data;
+	}
+	_data = NULL;
+	_capacity = _start = _end = 0;
+}
+
+std::size_t Buffer::find(const char *needle, std::size_t pos) const
+{
+	std::size_t len = std::strlen(needle);
+	if (len == 0 || pos + len > size())
+		return npos;
+	const char *begin = data();
+	const char *end = begin + size();
+	const char *hit = std::search(begin + pos, end, needle, needle + len);
+	return (hit == end) ? npos : static_cast<std::size_t>(hit - begin);
+}
+
+std::string Buffer::substr(std::size_t pos, std::size_t len) const
+{
+	if (pos >= size())
+		return std::string();
+	return std::string(data() + pos, std::min(len, size() - pos));
+}
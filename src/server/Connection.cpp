@@ -0,0 +1,89 @@
+#include "../../includes/Connection.hpp"
+
+// Connections allocated at once when the free list runs dry
+static const std::size_t CONNECTIONS_PER_BLOCK = 64;
+
+Connection::Connection(void)
+	: fd(-1), isListener(false), server(NULL), config(NULL), keepAlive(false), closeAfterFlush(false),
+	  keepAliveTimeout(0), requestCount(0), writeWatched(false), readQueued(false), readPaused(false), generation(0), nextFree(NULL)
+{
+}
+
+// Clears per-client state; the receive buffer goes back to the pool and a
+// small output buffer keeps its capacity for the next client; queued files are closed
+// The timer must already be cancelled
+void Connection::reset(void)
+{
+	fd = -1;
+	isListener = false;
+	server = NULL;
+	input.release();
+	parser.reset();
+	request.reset();
+	config = NULL;
+	route = Route();
+	output.clear();
+	keepAlive = false;
+	closeAfterFlush = false;
+	keepAliveTimeout = 0;
+	requestCount = 0;
+	writeWatched = false;
+	readQueued = false;
+	readPaused = false;
+	timer = TimerWheel::Timer();
+}
+
+ConnectionPool::ConnectionPool(void): _freeList(NULL) {}
+
+ConnectionPool::~ConnectionPool(void)
+{
+	for (std::size_t i = 0; i < _blocks.size(); ++i)
+		delete[] _blocks[i];
+}
+
+Connection *ConnectionPool::acquire(int fd)
+{
+	if (fd < 0)
+		return NULL;
+	if (!_freeList)
+		grow();
+	Connection *conn = _freeList;
+	_freeList = conn->nextFree;
+	conn->nextFree = NULL;
+	conn->fd = fd;
+	++conn->generation;
+	conn->input.setPool(&_buffers);
+	if (static_cast<std::size_t>(fd) >= _byFd.size())
+		_byFd.resize(fd + 1, NULL);
+	_byFd[fd] = conn;
+	return conn;
+}
+
+void ConnectionPool::release(Connection *conn)
+{
+	if (!conn)
+		return;
+	if (conn->fd >= 0 && static_cast<std::size_t>(conn->fd) < _byFd.size() && _byFd[conn->fd] == conn)
+		_byFd[conn->fd] = NULL;
+	conn->reset();
+	conn->nextFree = _freeList;
+	_freeList = conn;
+}
+
+Connection *ConnectionPool::find(int fd) const
+{
+	if (fd < 0 || static_cast<std::size_t>(fd) >= _byFd.size())
+		return NULL;
+	return _byFd[fd];
+}
+
+void ConnectionPool::grow(void)
+{
+	Connection *block = new Connection[CONNECTIONS_PER_BLOCK];
+	_blocks.push_back(block);
+	for (std::size_t i = CONNECTIONS_PER_BLOCK; i > 0; --i)
+	{
+		block[i - 1].nextFree = _freeList;
+		_freeList = &block[i - 1];
+	}
+}
@@ -0,0 +1,319 @@
+#include "../../includes/OutputQueue.hpp"
+
+// The queue's buffer is released instead of kept for the next responses when larger than this
+static const std::size_t MAX_RETAINED_BUFFER = 64 * 1024;
+// Strings shorter than this are copied into the buffer, so they can share a writev() entry
+static const std::size_t MIN_OWNED_SIZE = 4 * 1024;
+// Sent segments and buffer bytes are dropped from the front of a queue that has
+// not drained once there are at least this many and they make up half of it
+static const std::size_t MIN_COMPACT_SEGMENTS = 64;
+static const std::size_t MIN_COMPACT_BYTES = 64 * 1024;
+// Memory segments gathered by one writev()
+static const int MAX_IOVECS = 64;
+// Most of a file segment sent by one sendfile() call, so a fast client yields
+// between slices as with NGINX's sendfile_max_chunk
+static const std::size_t MAX_SENDFILE_SIZE = 2 * 1024 * 1024;
+
+OutputQueue::Segment::Segment(SegmentKind segmentKind)
+	: kind(segmentKind), offset(0), length(0), owned(), data(NULL), shared(NULL), file() {}
+
+OutputQueue::OutputQueue(void): _buffer(), _segments(), _head(0), _size(0), _files(0) {}
+
+// Copies share queued files through duplicated descriptors, and shared buffers
+OutputQueue::OutputQueue(const OutputQueue &obj)
+	: _buffer(obj._buffer), _segments(obj._segments), _head(obj._head), _size(obj._size), _files(obj._files)
+{
+	retainSegments();
+}
+
+OutputQueue::~OutputQueue(void) { clear(); }
+
+OutputQueue &OutputQueue::operator=(const OutputQueue &obj)
+{
+	if (this != &obj)
+	{
+		clear();
+		_buffer = obj._buffer;
+		_segments = obj._segments;
+		_head = obj._head;
+		_size = obj._size;
+		_files = obj._files;
+		retainSegments();
+	}
+	return (*this);
+}
+
+bool OutputQueue::empty(void) const { return _head == _segments.size(); }
+
+// Bytes still to be sent, file segments included
+std::size_t OutputQueue::size(void) const { return _size; }
+
+// Open files waiting to be sent
+std::size_t OutputQueue::fileCount(void) const { return _files; }
+
+// Adds length bytes to the end of the queue's buffer for the caller to fill in,
+// so a response header is serialized in place; they join the last segment
+// when that one ends where the buffer does
+char *OutputQueue::appendSpace(std::size_t length)
+{
+	if (empty() || _segments.back().kind != SEGMENT_BUFFER
+		|| _segments.back().offset + _segments.back().length != _buffer.size())
+	{
+		_segments.push_back(Segment(SEGMENT_BUFFER));
+		_segments.back().offset = _buffer.size();
+	}
+	std::size_t offset = _buffer.size();
+	_buffer.resize(offset + length);
+	_segments.back().length += length;
+	_size += length;
+	return &_buffer[offset];
+}
+
+// Copies data to the end of the queue
+void OutputQueue::append(const char *data, std::size_t length)
+{
+	if (length > 0)
+		std::memcpy(appendSpace(length), data, length);
+}
+
+void OutputQueue::append(const std::string &data) { append(data.data(), data.size()); }
+
+// Queues the contents of data without copying them; data is left empty
+void OutputQueue::appendOwned(std::string &data)
+{
+	if (data.size() < MIN_OWNED_SIZE)
+	{
+		append(data);
+		data.clear();
+		return;
+	}
+	_segments.push_back(Segment(SEGMENT_OWNED));
+	_segments.back().owned.swap(data);
+	_segments.back().length = _segments.back().owned.size();
+	_size += _segments.back().length;
+}
+
+// Queues memory that stays valid for as long as the queue may send it
+void OutputQueue::appendStatic(const char *data, std::size_t length)
+{
+	if (length == 0)
+		return;
+	_segments.push_back(Segment(SEGMENT_STATIC));
+	_segments.back().data = data;
+	_segments.back().length = length;
+	_size += length;
+}
+
+// Queues part of a shared buffer, holding a reference to it until it is sent
+void OutputQueue::appendShared(SharedBuffer *buffer, std::size_t offset, std::size_t length)
+{
+	if (length == 0)
+		return;
+	buffer->retain();
+	_segments.push_back(Segment(SEGMENT_SHARED));
+	_segments.back().shared = buffer;
+	_segments.back().offset = offset;
+	_segments.back().length = length;
+	_size += length;
+}
+
+// Queues a file range; the queue takes ownership of its descriptor
+void OutputQueue::appendFile(const FileRange &file)
+{
+	if (file.length == 0)
+	{
+		close(file.fd);
+		return;
+	}
+	_segments.push_back(Segment(SEGMENT_FILE));
+	_segments.back().file = file;
+	_size += file.length;
+	++_files;
+}
+
+// Sends from the front of the queue with a single syscall and drops what went out
+// Returns what write() would; 0 also when a file ends before its queued length
+ssize_t OutputQueue::send(int fd)
+{
+	if (empty())
+		return 0;
+	ssize_t sent = (_segments[_head].kind == SEGMENT_FILE) ? sendFile(fd) : sendMemory(fd);
+	if (sent > 0 && !empty())
+		compact();
+	return sent;
+}
+
+// Closes queued files, releases shared buffers and drops everything not sent yet
+void OutputQueue::clear(void)
+{
+	for (std::size_t i = _head; i < _segments.size(); ++i)
+	{
+		if (_segments[i].kind == SEGMENT_FILE)
+			close(_segments[i].file.fd);
+		else if (_segments[i].kind == SEGMENT_SHARED)
+			_segments[i].shared->release();
+	}
+	_segments.clear();
+	_head = 0;
+	_size = 0;
+	_files = 0;
+	if (_buffer.capacity() > MAX_RETAINED_BUFFER)
+		std::string().swap(_buffer);
+	else
+		_buffer.clear();
+}
+
+const char *OutputQueue::memoryOf(const Segment &segment) const
+{
+	if (segment.kind == SEGMENT_BUFFER)
+		return _buffer.data() + segment.offset;
+	if (segment.kind == SEGMENT_OWNED)
+		return segment.owned.data() + segment.offset;
+	if (segment.kind == SEGMENT_SHARED)
+		return segment.shared->data() + segment.offset;
+	return segment.data + segment.offset;
+}
+
+// Gathers the memory segments at the front into one writev()
+// When a file comes next, the data is sent with MSG_MORE so a header and the
+// start of its file leave in the same packet
+ssize_t OutputQueue::sendMemory(int fd)
+{
+	struct iovec iov[MAX_IOVECS];
+	int count = 0;
+	std::size_t i = _head;
+	for (; i < _segments.size() && count < MAX_IOVECS && _segments[i].kind != SEGMENT_FILE; ++i, ++count)
+	{
+		iov[count].iov_base = const_cast<char*>(memoryOf(_segments[i]));
+		iov[count].iov_len = _segments[i].length;
+	}
+	ssize_t sent;
+#ifdef MSG_MORE
+	if (i < _segments.size() && _segments[i].kind == SEGMENT_FILE)
+	{
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		sent = sendmsg(fd, &msg, MSG_MORE);
+	}
+	else
+#endif
+		sent = writev(fd, iov, count);
+	if (sent > 0)
+		consume(sent);
+	return sent;
+}
+
+// Next slice of the file at the front: sendfile() copies it from the page cache
+// to the socket without passing through user space; elsewhere it goes through a buffer
+ssize_t OutputQueue::sendFile(int fd)
+{
+	FileRange &file = _segments[_head].file;
+	std::size_t length = std::min(file.length, MAX_SENDFILE_SIZE);
+#ifdef __linux__
+	off_t offset = file.offset;
+	ssize_t sent = sendfile(fd, file.fd, &offset, length);
+#else
+	char buffer[64 * 1024];
+	ssize_t sent = pread(file.fd, buffer, std::min(length, sizeof(buffer)), file.offset);
+	if (sent > 0)
+		sent = write(fd, buffer, sent);
+#endif
+	if (sent > 0)
+	{
+		file.offset += sent;
+		file.length -= sent;
+		_size -= sent;
+		if (file.length == 0)
+			popSegment();
+	}
+	return sent;
+}
+
+// Drops sent bytes from the memory segments at the front
+void OutputQueue::consume(std::size_t sent)
+{
+	_size -= sent;
+	while (sent > 0)
+	{
+		Segment &segment = _segments[_head];
+		std::size_t n = std::min(sent, segment.length);
+		segment.offset += n;
+		segment.length -= n;
+		sent -= n;
+		if (segment.length == 0)
+			popSegment();
+	}
+}
+
+// The segment at the front has been sent; the storage of a fully drained
+// queue is reused for the next responses
+void OutputQueue::popSegment(void)
+{
+	Segment &segment = _segments[_head];
+	if (segment.kind == SEGMENT_FILE)
+	{
+		close(segment.file.fd);
+		--_files;
+	}
+	else if (segment.kind == SEGMENT_OWNED)
+		std::string().swap(segment.owned);
+	else if (segment.kind == SEGMENT_SHARED)
+		segment.shared->release();
+	++_head;
+	if (empty())
+		clear();
+}
+
+// A client that keeps pipelining may never let the queue drain completely, so the
+// sent prefix of _segments and of _buffer is reclaimed as it grows, like Buffer
+// does with its consumed head; owned strings are swapped rather than copied
+void OutputQueue::compact(void)
+{
+	if (_head >= MIN_COMPACT_SEGMENTS && _head * 2 >= _segments.size())
+	{
+		std::size_t live = _segments.size() - _head;
+		for (std::size_t i = 0; i < live; ++i)
+		{
+			Segment &from = _segments[_head + i];
+			std::string owned;
+			owned.swap(from.owned);
+			_segments[i] = from;
+			_segments[i].owned.swap(owned);
+		}
+		_segments.erase(_segments.begin() + live, _segments.end());
+		_head = 0;
+	}
+	// Buffer segments are appended in order, so the first one left starts the live bytes
+	std::size_t sent = _buffer.size();
+	for (std::size_t i = _head; i < _segments.size(); ++i)
+	{
+		if (_segments[i].kind == SEGMENT_BUFFER)
+		{
+			sent = _segments[i].offset;
+			break;
+		}
+	}
+	if (sent >= MIN_COMPACT_BYTES && sent * 2 >= _buffer.size())
+	{
+		_buffer.erase(0, sent);
+		for (std::size_t i = _head; i < _segments.size(); ++i)
+		{
+			if (_segments[i].kind == SEGMENT_BUFFER)
+				_segments[i].offset -= sent;
+		}
+	}
+}
+
+// A copied queue takes its own descriptors and references
+void OutputQueue::retainSegments(void)
+{
+	for (std::size_t i = _head; i < _segments.size(); ++i)
+	{
+		if (_segments[i].kind == SEGMENT_FILE)
+			_segments[i].file.fd = dupCloexec(_segments[i].file.fd);
+		else if (_segments[i].kind == SEGMENT_SHARED)
+			_segments[i].shared->retain();
+	}
+}
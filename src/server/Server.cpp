@@ -70,18 +70,33 @@ Server::~Server(void)
 int Server::getServerFD(void) const { return _serverFD; }
 const std::vector<ServerConfig> &Server::getConfigs(void) const {return _configs; }
 
-void Server::initSocket(void)
+// With reusePort, every worker binds its own listener on the same address
+// and the kernel spreads incoming connections across them
+void Server::initSocket(bool reusePort)
 {
 	try
 	{
 		if (_configs.empty())
 	    	throw std::runtime_error("No server configuration provided");
+#ifdef SOCK_CLOEXEC
+		_serverFD = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#else
 		_serverFD = socket(AF_INET, SOCK_STREAM, 0);
+		if (_serverFD != -1)
+			fcntl(_serverFD, F_SETFD, FD_CLOEXEC);
+#endif
 		if (_serverFD == -1)
 			throw std::runtime_error("Failed to create listening socket");
 		int opt = 1;
 		if (setsockopt(_serverFD, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) 
 			throw std::runtime_error("Failed to set socket options");
+#ifdef SO_REUSEPORT
+		if (reusePort && setsockopt(_serverFD, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+			throw std::runtime_error("Failed to set SO_REUSEPORT");
+#else
+		if (reusePort)
+			throw std::runtime_error("SO_REUSEPORT is not supported on this system");
+#endif
 		sockaddr_in address;
 		std::memset(&address, 0, sizeof(address));
 		address.sin_family = AF_INET;
@@ -92,6 +107,8 @@ void Server::initSocket(void)
 			throw std::runtime_error("Failed to bind socket");
 		if (listen(_serverFD, SOMAXCONN) < 0)
 			throw std::runtime_error("Failed to listen on socket");
+		if (fcntl(_serverFD, F_SETFL, O_NONBLOCK) < 0)
+			throw std::runtime_error("Failed to set listening socket non-blocking");
 	}
 	catch (...)
 	{
@@ -115,21 +132,22 @@ const ServerConfig& Server::selectServer(const std::string &hostHeader) const
 		return *(it->second);
 	}
 
-	// Fallback - search configs for one that has "default_server" as a server_name
+	debugMsg("No matching server name; using default server");
+	return getDefaultConfig();
+}
+
+// The config marked "default_server", else the first one
+// Used for connections whose Host is not known yet
+const ServerConfig& Server::getDefaultConfig(void) const
+{
 	for (size_t i = 0; i < _configs.size(); ++i)
 	{
 		const std::vector<std::string>& names = _configs[i].getServerNames();
 		for (size_t j = 0; j < names.size(); ++j)
 		{
 			if (names[j] == "default_server")
-			{
-				debugMsg("Using default_server fallback");
 				return _configs[i];
-			}
 		}
 	}
-
-	// Absolute fallback - return first config
-	debugMsg("No matching or default server; using first config as fallback");
 	return _configs[0];
 }
@@ -1,22 +1,35 @@
 #include "../../includes/ServerManager.hpp"
 
-ServerManager::ServerManager(void)
-{
-	FD_ZERO(&_master_read_fds);
-	FD_ZERO(&_master_write_fds);
-	_max_fd = 0;
-}
+// Pipelined requests are not parsed further while this much output is unsent
+static const std::size_t MAX_PIPELINE_OUTPUT = 256 * 1024;
+// Connections accepted per listener per loop iteration, so a connect burst cannot starve clients
+static const int ACCEPT_BATCH = 64;
+// How long a listener stops accepting after the process runs out of fds
+static const unsigned long ACCEPT_PAUSE_MS = 500;
+// Resolution of client timeouts
+static const unsigned long TIMER_TICK_MS = 100;
+// Bytes read from one client per loop iteration before others get their turn
+static const std::size_t READ_BUDGET = 1024 * 1024;
+// Receive buffers start small and double while reads keep filling them, up to this read size
+static const std::size_t MAX_READ_SIZE = 256 * 1024;
+// Largest body still read and dropped after an early error response to keep the
+// connection; the connection is closed instead when more would have to be read
+static const std::size_t MAX_DRAIN_SIZE = 64 * 1024;
+// Pipelined requests are not parsed further while this many files are queued
+static const std::size_t MAX_PIPELINE_FILES = 16;
+
+ServerManager::ServerManager(void): _connections(NULL), _backend(NULL), _timers(NULL), _reserveFD(-1), _rangeResponses(0) {}
+
+// Connections, the event backend, the timer wheel and the file caches are
+// per-instance state created in start(); they are never shared between copies
 ServerManager::ServerManager(const ServerManager &obj)
 	: _servers(obj._servers),
-	  _clientToServer(obj._clientToServer),
-	  _clientBuffers(obj._clientBuffers),
-	  _clientRequests(obj._clientRequests),
-	  _clientResponses(obj._clientResponses),
-	  _responseOffsets(obj._responseOffsets),
-	  _max_fd(obj._max_fd)
+	  _connections(NULL),
+	  _backend(NULL),
+	  _timers(NULL),
+	  _reserveFD(-1),
+	  _rangeResponses(0)
 {
-	_master_read_fds = obj._master_read_fds;
-	_master_write_fds = obj._master_write_fds;
 }
 
 ServerManager& ServerManager::operator=(const ServerManager &obj)
@@ -24,29 +37,34 @@ ServerManager& ServerManager::operator=(const ServerManager &obj)
 	if (this != &obj)
 	{
 		_servers = obj._servers;
-		_clientToServer = obj._clientToServer;
-		_clientBuffers = obj._clientBuffers;
-		_clientRequests = obj._clientRequests;
-		_clientResponses = obj._clientResponses;
-		_responseOffsets = obj._responseOffsets;
-		_max_fd = obj._max_fd;
-		_master_read_fds = obj._master_read_fds;
-		_master_write_fds = obj._master_write_fds;
+		clearFileCaches();
+		delete _timers;
+		_timers = NULL;
+		delete _backend;
+		_backend = NULL;
+		delete _connections;
+		_connections = NULL;
+		_readBacklog.clear();
+		_acceptBacklog.clear();
+		_pausedListeners.clear();
 	}
 	return *this;
 }
 
 ServerManager::~ServerManager(void)
 {
+	clearFileCaches();
+	delete _timers;
+	delete _backend;
+	delete _connections;
+	if (_reserveFD != -1)
+		close(_reserveFD);
 	for (size_t i = 0; i < _servers.size(); ++i)
 		close(_servers[i].getServerFD());
 }
 
-ServerManager::ServerManager(const std::vector<ServerConfig> &configs) : _max_fd(0)
+ServerManager::ServerManager(const std::vector<ServerConfig> &configs) : _connections(NULL), _backend(NULL), _timers(NULL), _reserveFD(-1), _rangeResponses(0)
 {
-	FD_ZERO(&_master_read_fds);
-	FD_ZERO(&_master_write_fds);
-
 	std::map<std::pair<std::string, int>, std::vector<ServerConfig> > grouped;
 	std::vector<ServerConfig> wildcardConfigs;
 
@@ -92,15 +110,15 @@ ServerManager::ServerManager(const std::vector<ServerConfig> &configs) : _max_fd
 	}
 }
 
-/// Initialises sockets on each Server and called once at startup in main()
-void	ServerManager::setup(void)
+/// Initialises sockets on each Server; called once per worker at startup
+void	ServerManager::setup(bool reusePort)
 {
 	size_t i = 0;
 	try
 	{
 		for (; i < _servers.size(); ++i)
 		{
-			_servers[i].initSocket();
+			_servers[i].initSocket(reusePort);
 		}
 	}
 	catch (const std::exception &e)
@@ -120,322 +138,414 @@ void	ServerManager::setup(void)
 	}
 }
 
-// Sets up initial fd_set for each serverFD
-// Calls selectLoop 
+// Creates the connection table, event backend and timer wheel and registers
+// each listening socket
+// Calls eventLoop
 void ServerManager::start(void)
 {
-	FD_ZERO(&_master_read_fds);
-	FD_ZERO(&_master_write_fds);
-	_max_fd = 0;
+	delete _connections;
+	_connections = new ConnectionPool();
+	delete _backend;
+	_backend = createEventBackend();
+	delete _timers;
+	_timers = new TimerWheel(TIMER_TICK_MS, monotonicMillis());
+	clearFileCaches();
+	if (_reserveFD == -1)
+		_reserveFD = open("/dev/null", O_RDONLY | O_CLOEXEC);
 
 	for (size_t i = 0; i < _servers.size(); ++i)
 	{
-		int fd = _servers[i].getServerFD();
-		FD_SET(fd, &_master_read_fds);
-		trackMaxFd(fd);
+		Connection *listener = _connections->acquire(_servers[i].getServerFD());
+		if (!listener)
+			fatalError("Invalid listening socket");
+		listener->isListener = true;
+		listener->server = &_servers[i];
+		if (!_backend->add(listener->fd, IEventBackend::EVENT_READ, listener))
+			fatalError("Failed to register listening socket");
 	}
-	debugMsg("Starting server. Initial max_fd = ", _max_fd);
-	selectLoop();
+	debugMsg(std::string("Starting server with ") + _backend->getName() + " backend");
+	eventLoop();
 }
 
-// Iterates over all FDs: 
-// - if it's a listening socket, accept a new client
-// - if it's a client socket, read and process request
-void ServerManager::selectLoop(void)
+// Only fds that are ready are visited, each through its Connection:
+// - listening sockets accept new clients
+// - client sockets are read/written according to the reported readiness
+// - then every client whose timeout has passed is expired
+void ServerManager::eventLoop(void)
 {
 	while (true)
 	{
-		fd_set read_fds = _master_read_fds;
-		fd_set write_fds = _master_write_fds;
-
-		debugMsg("Waiting for activity on fds max_fd = ", _max_fd);
-		int ready = select(_max_fd + 1, &read_fds, &write_fds, NULL, NULL);
+		int ready = _backend->wait(_events, nextWaitTimeout());
 		if (ready < 0)
-			fatalError("Select failed");
+			fatalError("Event wait failed");
+		// A client closed while the batch is handled can have its fd and its
+		// Connection reused by a client accepted later in the same batch
+		_eventGenerations.resize(_events.size());
+		for (size_t i = 0; i < _events.size(); ++i)
+			_eventGenerations[i] = static_cast<Connection*>(_events[i].data)->generation;
+
+		// Listeners left with queued connections last time get their next batch first
+		std::vector<const Server*> backlog;
+		backlog.swap(_acceptBacklog);
+		for (size_t i = 0; i < backlog.size(); ++i)
+			acceptNewClient(*backlog[i]);
+
+		// So do clients that ran out of read budget
+		std::vector<Connection*> readBacklog;
+		readBacklog.swap(_readBacklog);
+		for (size_t i = 0; i < readBacklog.size(); ++i)
+		{
+			if (readBacklog[i]->readQueued)
+				handleClientEvent(*readBacklog[i], IEventBackend::EVENT_READ);
+		}
 
-		for (int fd = 0; fd <= _max_fd; ++fd)
+		for (size_t i = 0; i < _events.size(); ++i)
 		{
-			if (FD_ISSET(fd, &read_fds))
-			{
-				if (isListeningSocket(fd))
-					acceptNewClient(fd);
-				else
-				{
-					int parseError = 0;
-					Request tempRequest;
-					if (!handleClientRead(fd, parseError, &tempRequest))
-					{
-						if (parseError > 0)
-							sendErrorResponse(fd, parseError, tempRequest);
-						else if (parseError == -1)
-						{
-							cleanupClient(fd);  // client closed connection
-							debugMsg("Cleaned up FD = ", fd);
-						}
-						else
-							sendErrorResponse(fd, 500, tempRequest);  // fallback error
-
-						continue;
-					}
-					std::map<int, Request>::iterator it = _clientRequests.find(fd);
-					if (it != _clientRequests.end())
-						processClientRequest(fd, it->second);
-				}
-			}
-			else if (FD_ISSET(fd, &write_fds))
-				handleClientWrite(fd);
+			const IEventBackend::Event &ev = _events[i];
+			Connection *conn = static_cast<Connection*>(ev.data);
+			if (conn->fd != ev.fd || conn->generation != _eventGenerations[i])
+				continue; // closed earlier in this batch, possibly reused since
+			if (conn->isListener)
+				acceptNewClient(*conn->server);
+			else
+				handleClientEvent(*conn, ev.events);
 		}
+		resumeListeners(false);
+		expireTimers();
 	}
 }
 
-bool ServerManager::isListeningSocket(int fd) const
+// Don't sleep while listeners or clients have data queued; wake up for paused
+// listeners and the next timer tick that has timers due; otherwise sleep until activity
+int ServerManager::nextWaitTimeout(void) const
 {
-	for (size_t i = 0; i < _servers.size(); ++i)
+	if (!_acceptBacklog.empty() || !_readBacklog.empty())
+		return 0;
+	unsigned long now = monotonicMillis();
+	int timeoutMs = _timers->nextTimeout(now);
+	if (!_pausedListeners.empty())
 	{
-		if (_servers[i].getServerFD() == fd)
-			return true;
+		for (std::map<const Server*, unsigned long>::const_iterator it = _pausedListeners.begin(); it != _pausedListeners.end(); ++it)
+		{
+			int remaining = (it->second > now) ? static_cast<int>(it->second - now) : 0;
+			if (timeoutMs < 0 || remaining < timeoutMs)
+				timeoutMs = remaining;
+		}
 	}
-	return false;
+	return timeoutMs;
 }
 
-// Accepts client connection and adds clientFD to fds for monitoring
-// Stores mapping of client to server in _clientToServer
-void ServerManager::acceptNewClient(int serverFD)
+// A closed connection is reset with fd -1 and stays valid memory in the pool,
+// so callers check conn.fd after anything that may have closed it
+void ServerManager::handleClientEvent(Connection &conn, int events)
 {
-	int clientFD = accept(serverFD, NULL, NULL);
-	if (clientFD < 0)
-		fatalError("Accept failed");
-
-	if (fcntl(clientFD, F_SETFL, O_NONBLOCK) < 0)
+	if (events & IEventBackend::EVENT_READ)
 	{
-		close(clientFD);
-		fatalError("fcntl failed");
+		int readError = 0;
+		if (!readFromClient(conn, readError))
+		{
+			if (readError == -1)
+				cleanupClient(conn);  // client closed connection
+			else
+			{
+				sendErrorResponse(conn, 500, Request());  // fallback error
+				handleClientWrite(conn);
+			}
+			return;
+		}
+		processBufferedRequests(conn);
+		requeueRead(conn);
 	}
-
-	FD_SET(clientFD, &_master_read_fds);
-	trackMaxFd(clientFD);
-
-	const Server *server = getListeningServerByFD(serverFD);
-	if (server)
-		_clientToServer[clientFD] = server;
-
-	debugMsg("Accepted new client: FD = ", clientFD);
+	else if (events & IEventBackend::EVENT_ERROR)
+	{
+		cleanupClient(conn);
+		return;
+	}
+	if (conn.fd != -1 && !conn.output.empty())
+		handleClientWrite(conn);
+	// A partial request is left over and nothing is waiting to be sent
+	if (conn.fd != -1 && conn.output.empty() && !conn.input.empty())
+		armReadTimer(conn);
 }
 
-
-// Reads incoming data from client socket 
-// Stores raw data into _clientBuffers
-// If headers are complete, parses into Request and stores it in _clientRequests
-// If headers are incomplete, return to poll loop to read some more 
-bool ServerManager::handleClientRead(int clientFD, int &parseError, Request *tempReq)
+// Accepts up to ACCEPT_BATCH clients with accept4 (non-blocking and close-on-exec
+// in one syscall) and registers them with the event backend
+// A listener that still has queued connections is revisited on the next loop
+// iteration, since its readiness edge has already been consumed
+// Running out of fds never stops the server: the connection is shed and the
+// listener backs off until a client closes or the pause expires
+void ServerManager::acceptNewClient(const Server &server)
 {
-	std::string& buffer = _clientBuffers[clientFD];
-
-	if (!readFromClient(clientFD, buffer, parseError))
-		return false;
-
-	if (!headersComplete(buffer))
-		return true;
-
-	if (!parseTempHeaders(buffer, *tempReq))
+	if (_pausedListeners.count(&server))
+		return;
+	for (int accepted = 0; accepted < ACCEPT_BATCH; ++accepted)
 	{
-		parseError = tempReq->getParseErrorCode();
-		return false;
+#ifdef __linux__
+		int clientFD = accept4(server.getServerFD(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+		int clientFD = accept(server.getServerFD(), NULL, NULL);
+		if (clientFD >= 0 && (fcntl(clientFD, F_SETFL, O_NONBLOCK) < 0 || fcntl(clientFD, F_SETFD, FD_CLOEXEC) < 0))
+		{
+			close(clientFD);
+			continue;
+		}
+#endif
+		if (clientFD < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO)
+				continue;
+			if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+			{
+				errorMsg("Out of file descriptors; shedding connection", server.getServerFD());
+				shedConnection(server);
+				pauseListener(server);
+				return;
+			}
+			errorMsg(std::string("Accept failed: ") + std::strerror(errno), server.getServerFD());
+			return;
+		}
+		if (!registerClient(clientFD, server))
+			close(clientFD);
 	}
+	_acceptBacklog.push_back(&server);
+}
 
-	if (!isBodyComplete(buffer, *tempReq, parseError))
-		return true;
-
-	if (!parseFullRequest(buffer, _clientRequests[clientFD]))
+bool ServerManager::registerClient(int clientFD, const Server &server)
+{
+	Connection *conn = _connections->acquire(clientFD);
+	if (!conn || !_backend->add(clientFD, IEventBackend::EVENT_READ, conn))
 	{
-		*tempReq = _clientRequests[clientFD];
-		parseError = _clientRequests[clientFD].getParseErrorCode();
+		errorMsg("Cannot monitor client; dropping connection", clientFD);
+		_connections->release(conn);
 		return false;
 	}
+	conn->server = &server;
+	armTimer(*conn, TIMER_HEADER, server.getDefaultConfig().getClientHeaderTimeout());
+	debugMsg("Accepted new client: FD = ", clientFD);
 	return true;
 }
 
-void ServerManager::sendErrorResponse(int fd, int errorCode, const Request& request)
+// Frees the reserve fd for long enough to accept and immediately close one
+// pending connection, so the client gets a prompt close instead of hanging in the backlog
+void ServerManager::shedConnection(const Server &server)
 {
-	std::string hostHeader = request.getHeader("host");
-	const Server* server = _clientToServer[fd];
-	const ServerConfig& config = server ? server->selectServer(hostHeader) : ServerConfig();
-
-	Response response;
-	response.setError(errorCode, config);
-	bufferResponse(fd, response.toString());
+	if (_reserveFD == -1)
+		return;
+	close(_reserveFD);
+	_reserveFD = -1;
+	int clientFD = accept(server.getServerFD(), NULL, NULL);
+	if (clientFD >= 0)
+		close(clientFD);
+	_reserveFD = open("/dev/null", O_RDONLY | O_CLOEXEC);
 }
 
-bool ServerManager::readFromClient(int fd, std::string& buffer, int& parseError)
+void ServerManager::pauseListener(const Server &server)
 {
-	char tempBuf[1024];
-	std::memset(tempBuf, 0, sizeof(tempBuf));
+	_backend->remove(server.getServerFD());
+	_pausedListeners[&server] = monotonicMillis() + ACCEPT_PAUSE_MS;
+}
 
-	ssize_t bytesRead = read(fd, tempBuf, sizeof(tempBuf) - 1);
-	if (bytesRead < 0)
-	{
-		errorMsg("Read failed on FD = ", fd);
-		parseError = 0;   // server error
-		return false;
-	}
-	else if (bytesRead == 0)
+// Re-arms paused listeners once their pause expires, or immediately when a client
+// has closed and freed an fd (force); re-adding an fd with a queued backlog reports it ready
+void ServerManager::resumeListeners(bool force)
+{
+	if (_pausedListeners.empty())
+		return;
+	unsigned long now = monotonicMillis();
+	std::map<const Server*, unsigned long>::iterator it = _pausedListeners.begin();
+	while (it != _pausedListeners.end())
 	{
-		debugMsg("Client closed connection: FD = ", fd);
-		parseError = -1;  // client disconnected
-		return false;
+		if (!force && it->second > now)
+		{
+			++it;
+			continue;
+		}
+		const Server *server = it->first;
+		_pausedListeners.erase(it++);
+		if (!_backend->add(server->getServerFD(), IEventBackend::EVENT_READ, _connections->find(server->getServerFD())))
+			errorMsg("Failed to resume listening socket", server->getServerFD());
+		else
+			debugMsg("Resumed accepting on listener FD = ", server->getServerFD());
 	}
+}
 
-	buffer.append(tempBuf, bytesRead);
-	return true;
+// A connection is closing once a queued response has announced "Connection: close"
+bool ServerManager::isClosing(const Connection &conn) const
+{
+	return conn.closeAfterFlush;
 }
 
-bool ServerManager::headersComplete(const std::string& buffer)
+// No more requests are served until the client reads what is queued: enough
+// output (or enough open files) is waiting, or the connection is closing
+bool ServerManager::isBackpressured(const Connection &conn) const
 {
-	return buffer.find("\r\n\r\n") != std::string::npos;
+	return isClosing(conn) || conn.output.size() >= MAX_PIPELINE_OUTPUT
+		|| conn.output.fileCount() >= MAX_PIPELINE_FILES;
 }
 
-bool ServerManager::parseTempHeaders(const std::string& buffer, Request& tempReq)
+// Stops reading a backpressured client, so what it keeps sending waits in the
+// kernel and TCP flow control slows it down instead of piling up in its buffer
+void ServerManager::pauseReading(Connection &conn)
 {
-	std::string::size_type headerEnd = buffer.find("\r\n\r\n");
-	std::string headers = buffer.substr(0, headerEnd + 4);
+	if (conn.readPaused)
+		return;
+	conn.readPaused = true;
+	updateInterest(conn);
+	debugMsg("Paused reading: FD = ", conn.fd);
+}
 
-	if (!tempReq.parse(headers))
+// The client has drained its output below the limits: reading resumes on the
+// next loop iteration, since data that arrived meanwhile has already had its edge
+void ServerManager::resumeReading(Connection &conn)
+{
+	conn.readPaused = false;
+	updateInterest(conn);
+	if (!conn.readQueued)
 	{
-		errorMsg("Invalid headers");
-		return false;
+		conn.readQueued = true;
+		_readBacklog.push_back(&conn);
 	}
-	return true;
+	debugMsg("Resumed reading: FD = ", conn.fd);
 }
 
-bool ServerManager::isBodyComplete(const std::string& buffer, const Request& tempReq, int &parseError)
+// Parses and answers every complete request already buffered, in arrival order,
+// so pipelined requests are served from a single read
+// The parser resumes where the previous read left it; a finished request is
+// consumed from the buffer once it has been answered
+// Requests are checked as soon as their header is in; one refused then has its
+// body discarded rather than handled
+// Stops at an incomplete request or once the connection is backpressured
+void ServerManager::processBufferedRequests(Connection &conn)
 {
-	std::string::size_type headerEnd = buffer.find("\r\n\r\n");
-	if (headerEnd == std::string::npos)
-		return false;
-
-	std::string contentLengthStr = tempReq.getHeader("content-length");
-	std::string transferEncoding = tempReq.getHeader("transfer-encoding");
+	Buffer &buffer = conn.input;
 
-	// === Handle Transfer-Encoding: chunked ===
-	if (!transferEncoding.empty() && transferEncoding == "chunked")
+	while (!buffer.empty() && !isBackpressured(conn))
 	{
-		std::size_t pos = headerEnd + 4;
-
-		while (pos < buffer.size())
+		RequestParser::Status status = conn.parser.parse(buffer, conn.request);
+		if (status == RequestParser::PARSE_INCOMPLETE)
+			return;
+		if (status == RequestParser::PARSE_HEADERS_COMPLETE)
 		{
-			std::size_t lineEnd = buffer.find("\r\n", pos);
-			if (lineEnd == std::string::npos)
-				return false; // Incomplete chunk size line
-
-			std::string chunkSizeStr = buffer.substr(pos, lineEnd - pos);
-			char* endptr;
-			long chunkSize = std::strtol(chunkSizeStr.c_str(), &endptr, 16);
-
-			// Check for invalid or negative chunk size
-			if (*endptr != '\0' || chunkSize < 0)
-			{
-				parseError = 400;
-				return false;
-			}
-
-			pos = lineEnd + 2;
-
-			// Check if chunk data is fully received
-			if (pos + chunkSize + 2 > buffer.size())
-				return false;
+			prepareBody(conn);
+			continue;
+		}
+		if (status == RequestParser::PARSE_ERROR)
+		{
+			sendErrorResponse(conn, conn.parser.getErrorCode(), conn.request);
+			return;
+		}
+		if (!conn.parser.discardsBody())
+			processClientRequest(conn, conn.request);
+		buffer.consume(conn.parser.getRequestLength());
+		conn.parser.reset();
+		conn.request.reset();
+	}
+}
 
-			// Ensure chunk is followed by CRLF
-			if (buffer.substr(pos + chunkSize, 2) != "\r\n")
-			{
-				parseError = 400;
-				return false;
-			}
+// The request could not be framed, so the connection is closed after the error
+void ServerManager::sendErrorResponse(Connection &conn, int errorCode, const Request& request)
+{
+	conn.keepAlive = false;
+	const ServerConfig& config = conn.server->selectServer(request.getHeader("host"));
 
-			pos += chunkSize + 2;
+	Response response;
+	response.setError(errorCode, config);
+	bufferResponse(conn, response);
+}
 
-			if (chunkSize == 0)
-				return true; // Final chunk received
-		}
-		return false; // More data expected
+// Drains the socket until it would block, since readiness is reported once per edge,
+// reading straight into the connection's buffer
+// The buffer grows while reads keep filling it, so bulk uploads take few large
+// reads while idle connections stay small
+// A client still sending after READ_BUDGET bytes is left for the next loop
+// iteration so it cannot starve the others (see requeueRead())
+// A backpressured client is not read at all until its output drains
+bool ServerManager::readFromClient(Connection &conn, int& parseError)
+{
+	conn.readQueued = false;
+	if (isBackpressured(conn))
+	{
+		pauseReading(conn);
+		return true;
 	}
-
-	// === Handle Content-Length ===
-	if (!contentLengthStr.empty())
+	std::size_t budget = READ_BUDGET;
+	while (budget > 0)
 	{
-		char* endptr;
-		long contentLength = std::strtol(contentLengthStr.c_str(), &endptr, 10);
-		if (*endptr != '\0' || contentLength < 0)
+		if (conn.input.writable() == 0)
+			conn.input.reserve(std::min(std::max(conn.input.capacity(), static_cast<std::size_t>(1)), MAX_READ_SIZE));
+		ssize_t bytesRead = read(conn.fd, conn.input.writePtr(), std::min(conn.input.writable(), budget));
+		if (bytesRead < 0)
 		{
-			parseError = 400;
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return true;
+			errorMsg("Read failed on FD = ", conn.fd);
+			parseError = 0;   // server error
 			return false;
 		}
-
-		std::size_t bodySize = buffer.length() - (headerEnd + 4);
-		return bodySize >= static_cast<std::size_t>(contentLength);
+		else if (bytesRead == 0)
+		{
+			debugMsg("Client closed connection: FD = ", conn.fd);
+			parseError = -1;  // client disconnected
+			return false;
+		}
+		conn.input.commit(bytesRead);
+		budget -= bytesRead;
 	}
-
-	// === No body expected ===
+	conn.readQueued = true;
 	return true;
 }
 
-bool ServerManager::parseFullRequest(const std::string& buffer, Request& requestOut)
+// A client that used up its read budget is read again on the next loop iteration,
+// unless the requests just served from it have backpressured the connection:
+// it then waits for its output to drain like any other paused client
+void ServerManager::requeueRead(Connection &conn)
 {
-	if (!requestOut.parse(buffer))
+	if (!conn.readQueued || conn.fd == -1)
+		return;
+	if (isBackpressured(conn))
 	{
-		errorMsg("Full request parse failed");
-		return false;
+		conn.readQueued = false;
+		pauseReading(conn);
 	}
-	return true;
+	else
+		_readBacklog.push_back(&conn);
 }
 
-// Matches correct ServerConfig and Route
-// Obtain max body size if specified 
-// Validate request body (using max body size + other checks)
-// Dispatches request to appropriate handler
-void ServerManager::processClientRequest(int clientFD, Request& request)
+// Validates the request body and dispatches the request to the handler of the
+// location matched when its header arrived
+void ServerManager::processClientRequest(Connection &conn, Request& request)
 {
-	const ServerConfig* config = getSelectedConfig(clientFD, request);
-	if (!config)
-	{
-		Response res;
-		res.setError(500, *config);
-		bufferResponse(clientFD, res.toString());
-		return;
-	}
-
-	Route matchedRoute;
-	if (!matchRouteOrRespond404(clientFD, request, *config, matchedRoute))
-		return;
+	const ServerConfig &config = *conn.config;
+	countRequest(conn, request, config);
 
-	std::size_t maxBodySize = getMaxBodySize(matchedRoute, *config);
-	if (!validateRequestOrRespondError(clientFD, request, *config, maxBodySize))
+	std::size_t maxBodySize = getMaxBodySize(conn.route, config);
+	if (!validateRequestOrRespondError(conn, request, config, maxBodySize))
 		return;
-	generateResponseAndBuffer(clientFD, request, matchedRoute, *config);
-
+	generateResponseAndBuffer(conn, request, conn.route, config);
 }
 
-const ServerConfig* ServerManager::getSelectedConfig(int clientFD, const Request& request)
+// A final response is about to be queued for the request: counts it and decides
+// whether the connection persists after it
+void ServerManager::countRequest(Connection &conn, const Request& request, const ServerConfig& config)
 {
-	std::map<int, const Server*>::iterator it = _clientToServer.find(clientFD);
-	if (it == _clientToServer.end() || !it->second)
-	{
-		errorMsg("No server associated with client", clientFD);
-		return NULL;
-	}
-	const Server* server = it->second;
-	return &server->selectServer(request.getHeader("host"));
+	_timers->cancel(conn.timer); // the next timeout depends on how the response goes out
+	std::size_t served = ++conn.requestCount;
+	conn.keepAlive = request.isKeepAlive() && config.getKeepaliveTimeout() > 0 && served < config.getKeepaliveRequests();
+	conn.keepAliveTimeout = config.getKeepaliveTimeout();
 }
 
-bool ServerManager::matchRouteOrRespond404(int clientFD, const Request& request, const ServerConfig& config, Route& matchedRoute)
+const ServerConfig* ServerManager::getSelectedConfig(const Connection &conn, const Request& request)
 {
-	if (!config.matchRoute(request.getTarget(), matchedRoute))
+	if (!conn.server)
 	{
-		Response res;
-		res.setError(404, config);
-		bufferResponse(clientFD, res.toString());
-		return false;
+		errorMsg("No server associated with client", conn.fd);
+		return NULL;
 	}
-	return true;
+	return &conn.server->selectServer(request.getHeader("host"));
 }
 
 std::size_t ServerManager::getMaxBodySize(const Route& route, const ServerConfig& config)
@@ -448,23 +558,127 @@ std::size_t ServerManager::getMaxBodySize(const Route& route, const ServerConfig
 		return DEFAULT_MAX_BODY_SIZE;
 }
 
-bool ServerManager::validateRequestOrRespondError(int clientFD, Request& request, const ServerConfig& config, std::size_t maxBodySize)
+// The header of the request has just arrived: matches the virtual server and
+// location, and refuses there and then what they would refuse anyway
+// (404, 405, 411, 413, 417), so no body is received only to be rejected
+// An accepted request gets the location's body limits; a multipart upload
+// starts streaming into its upload_dir, and a client waiting on
+// "Expect: 100-continue" is told to send the body
+void ServerManager::prepareBody(Connection &conn)
+{
+	Request &request = conn.request;
+	conn.config = getSelectedConfig(conn, request);
+	if (!conn.config)
+		return rejectRequest(conn, 500);
+	const ServerConfig &config = *conn.config;
+	request.setBodyBufferSize(config.getClientBodyBufferSize());
+
+	if (!config.matchRoute(request.getTarget(), conn.route))
+		return rejectRequest(conn, 404);
+	if (!conn.route.isMethodAllowed(request.getMethod()))
+		return rejectRequest(conn, 405);
+	if (request.getMethod() == "POST" && !conn.parser.hasBodyLength())
+		return rejectRequest(conn, 411);
+	std::size_t maxBodySize = getMaxBodySize(conn.route, config);
+	if (conn.parser.getContentLength() > maxBodySize)
+		return rejectRequest(conn, 413);
+	std::string expect = request.getHeader("expect");
+	if (!expect.empty() && ::toLower(expect) != "100-continue")
+		return rejectRequest(conn, 417);
+	conn.parser.setMaxBodySize(maxBodySize);
+
+	RequestDispatcher dispatcher;
+	if (dispatcher.isMultipartUpload(request, conn.route) && !request.startMultipartUpload(conn.route.getUploadDir()))
+		return rejectRequest(conn, request.getParseErrorCode());
+
+	// Interim response, only while none of the body has been sent; it is queued
+	// as is, and the final response decides whether the connection persists
+	if (!expect.empty() && conn.parser.inBody() && conn.input.size() == conn.parser.getRequestLength()
+		&& request.getVersion() == "HTTP/1.1")
+	{
+		static const char continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+		conn.output.appendStatic(continueResponse, sizeof(continueResponse) - 1);
+	}
+}
+
+// Answers a request from its header alone
+// A small body is then drained so the connection can be kept; a large or
+// chunked one, or one the client holds back for 100-continue, is not worth
+// waiting for, and the connection closes after the response
+void ServerManager::rejectRequest(Connection &conn, int code)
+{
+	ServerConfig fallback;
+	const ServerConfig &config = conn.config ? *conn.config : fallback;
+	countRequest(conn, conn.request, config);
+	if (conn.parser.inBody() && (conn.parser.isChunked() || conn.parser.getContentLength() > MAX_DRAIN_SIZE
+		|| !conn.request.getHeader("expect").empty()))
+		conn.keepAlive = false;
+	debugMsg("Request refused before its body: " + toString(code));
+
+	Response res;
+	res.setError(code, config);
+	bufferResponse(conn, res);
+	conn.parser.discardBody();
+}
+
+bool ServerManager::validateRequestOrRespondError(Connection &conn, Request& request, const ServerConfig& config, std::size_t maxBodySize)
 {
 	if (!request.validateBody(maxBodySize))
 	{
 		Response res;
 		res.setError(request.getParseErrorCode(), config);
-		bufferResponse(clientFD, res.toString());
+		bufferResponse(conn, res);
 		return false;
 	}
 	return true;
 }
 
-void ServerManager::generateResponseAndBuffer(int clientFD, const Request& request, const Route& route, const ServerConfig& config)
+// A location of the virtual server compresses responses on the fly
+static bool hasGzipLocation(const ServerConfig &config)
+{
+	const std::vector<Route> &routes = config.getRoutes();
+	for (std::size_t i = 0; i < routes.size(); ++i)
+	{
+		if (routes[i].getGzip())
+			return true;
+	}
+	return false;
+}
+
+// The virtual server's open_file_cache and content_cache for this event loop,
+// created on first use; a cache the server has off is NULL
+const FileCaches &ServerManager::getFileCaches(const ServerConfig &config)
+{
+	std::map<const ServerConfig*, FileCaches>::iterator it = _fileCaches.find(&config);
+	if (it != _fileCaches.end())
+		return it->second;
+	FileCaches &caches = _fileCaches[&config];
+	if (config.getOpenFileCacheMax() > 0)
+		caches.openFiles = new OpenFileCache(config.getOpenFileCacheMax(), config.getOpenFileCacheInactive(),
+			config.getOpenFileCacheValid(), config.getOpenFileCacheErrors());
+	if (config.getContentCacheSize() > 0)
+		caches.content = new ContentCache(config.getContentCacheSize(), config.getContentCacheMaxFile());
+	else if (hasGzipLocation(config))
+		caches.compressed = new ContentCache(GZIP_CACHE_SIZE, config.getContentCacheMaxFile());
+	return caches;
+}
+
+void ServerManager::clearFileCaches(void)
+{
+	for (std::map<const ServerConfig*, FileCaches>::iterator it = _fileCaches.begin(); it != _fileCaches.end(); ++it)
+	{
+		delete it->second.openFiles;
+		delete it->second.content;
+		delete it->second.compressed;
+	}
+	_fileCaches.clear();
+}
+
+void ServerManager::generateResponseAndBuffer(Connection &conn, const Request& request, const Route& route, const ServerConfig& config)
 {
 	Response response;
 	RequestDispatcher dispatcher;
-	IRequestHandler* handler = dispatcher.selectHandler(request, route, config);
+	IRequestHandler* handler = dispatcher.selectHandler(request, route, config, getFileCaches(config), _rangeResponses);
 
 	if (!handler)
 	{
@@ -473,111 +687,213 @@ void ServerManager::generateResponseAndBuffer(int clientFD, const Request& reque
 		} else {
 			response.setError(405, config);
 		}
-		bufferResponse(clientFD, response.toString());
+		bufferResponse(conn, response);
 		return;
 	}
 
 	handler->handle(request, response);
 	delete handler;
+	compressResponse(request, route, response);
 
-	bufferResponse(clientFD, response.toString());
+	bufferResponse(conn, response);
 }
 
-void ServerManager::bufferResponse(int fd, const std::string& responseStr)
+// Errors that leave the request framing in doubt; the rest of the stream cannot be trusted
+static bool breaksFraming(int code)
 {
-	_clientResponses[fd] = responseStr;
-	_responseOffsets[fd] = 0;
-	FD_SET(fd, &_master_write_fds);
-	trackMaxFd(fd);
+	return code == 400 || code == 408 || code == 411 || code == 413 || code == 414 || code == 426 || code == 431;
 }
 
-void ServerManager::handleClientWrite(int fd)
+// Announces whether the connection persists, then serializes the header straight
+// into the output queue and queues the body behind it; pipelined responses queue up in request order
+// Bodies are not copied: a string body is handed over to the queue and a file
+// body's descriptor is sent from directly, as are the file ranges of a body in parts
+// A response rendered ahead by the content_cache is queued from the shared
+// buffer, with the fields set for this response (Connection, ...) spliced in
+// before the blank line
+void ServerManager::bufferResponse(Connection &conn, Response& response)
 {
-	std::map<int, std::string>::iterator respIt = _clientResponses.find(fd);
-	if (respIt == _clientResponses.end())
+	if (breaksFraming(response.getStatusCode()))
+		conn.keepAlive = false;
+	response.setHeader("Connection", conn.keepAlive ? "keep-alive" : "close");
+	if (!conn.keepAlive)
+		conn.closeAfterFlush = true;
+	if (SharedBuffer *rendered = response.getRendered())
 	{
-		errorMsg("No response buffer found for FD = ", fd);
-		cleanupClient(fd);  // To prevent stuck connection
+		std::size_t headerLength = response.getRenderedHeaderLength();
+		conn.output.appendShared(rendered, 0, headerLength - 2);
+		char *end = response.serializeFields(conn.output.appendSpace(response.fieldsSize() + 2));
+		end[0] = '\r';
+		end[1] = '\n';
+		conn.output.appendShared(rendered, headerLength, rendered->size() - headerLength);
 		return;
 	}
 
-	std::string &response = respIt->second;
-	size_t &offset = _responseOffsets[fd];
-
-	ssize_t bytesSent = write(fd, response.c_str() + offset, response.size() - offset);
-
-	if (bytesSent < 0)
+	response.serializeHeader(conn.output.appendSpace(response.headerSize()));
+	if (response.hasFile())
+		conn.output.appendFile(response.releaseFile());
+	else if (response.hasParts())
 	{
-		errorMsg("Write failed on FD = ", fd);
-		cleanupClient(fd);
-		return;
+		std::vector<BodyPart> parts;
+		response.releaseParts(parts);
+		for (std::size_t i = 0; i < parts.size(); ++i)
+		{
+			if (parts[i].file.fd != -1)
+				conn.output.appendFile(parts[i].file);
+			else
+				conn.output.append(parts[i].data);
+		}
 	}
-	else if (bytesSent == 0)
+	else
 	{
-		debugMsg("Write returned 0: connection closed or interrupted");
-		cleanupClient(fd);
-		return;
+		std::string body;
+		response.releaseBody(body);
+		conn.output.appendOwned(body);
 	}
-	offset += bytesSent;
+}
 
-	// If not done writing yet, wait for next select()
-	if (offset < response.size())
+// Writes until the queued output is fully sent or the socket would block;
+// the backend reports readiness edges, so stopping early would stall the client
+// Once drained, requests that were held back are served before going idle
+// send_timeout runs from the last write that made progress
+void ServerManager::handleClientWrite(Connection &conn)
+{
+	bool progressed = false;
+	while (true)
 	{
-		debugMsg("Partial write: waiting to finish FD = ", fd);
-		return;
+		while (!conn.output.empty())
+		{
+			ssize_t bytesSent = conn.output.send(conn.fd);
+			if (bytesSent < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+				{
+					debugMsg("Partial write: waiting to finish FD = ", conn.fd);
+					watchWritable(conn, true);
+					if (progressed || !_timers->isScheduled(conn.timer) || conn.timer.kind != TIMER_SEND)
+						armTimer(conn, TIMER_SEND, conn.server->getDefaultConfig().getSendTimeout());
+					return;
+				}
+				errorMsg("Write failed on FD = ", conn.fd);
+				cleanupClient(conn);
+				return;
+			}
+			else if (bytesSent == 0)
+			{
+				debugMsg("Write returned 0: connection closed or interrupted");
+				cleanupClient(conn);
+				return;
+			}
+			progressed = true;
+			if (conn.readPaused && !isBackpressured(conn))
+				resumeReading(conn);
+		}
+
+		debugMsg("Full response sent to FD = ", conn.fd);
+		if (conn.closeAfterFlush)
+		{
+			cleanupClient(conn);
+			return;
+		}
+		processBufferedRequests(conn);
+		if (conn.output.empty())
+			break;
 	}
+	keepClientAlive(conn);
+}
 
-	// Full response sent — cleanup
-	debugMsg("Full response sent to FD = ", fd);
-	cleanupClient(fd);
+// Output is written as soon as it is produced; writability is only watched
+// while the socket is full, which keeps level-triggered backends from spinning
+void ServerManager::watchWritable(Connection &conn, bool enable)
+{
+	if (conn.writeWatched == enable)
+		return;
+	conn.writeWatched = enable;
+	updateInterest(conn);
 }
 
-// Used to get Server object for a given listening socket
-// Does not work if given a clientFD
-const Server* ServerManager::getListeningServerByFD(int fd) const
+// Readability is watched unless reading is paused, writability while the socket is full
+void ServerManager::updateInterest(Connection &conn)
 {
-	for (size_t i = 0; i < _servers.size(); ++i)
+	int events = (conn.readPaused ? 0 : IEventBackend::EVENT_READ)
+		| (conn.writeWatched ? IEventBackend::EVENT_WRITE : 0);
+	if (!_backend->modify(conn.fd, events, &conn))
+		errorMsg("Failed to update event interest", conn.fd);
+}
+
+// All queued output has been sent and the connection persists
+// Starts the idle countdown unless part of the next request is already buffered
+void ServerManager::keepClientAlive(Connection &conn)
+{
+	watchWritable(conn, false);
+	if (conn.input.empty())
 	{
-		if (_servers[i].getServerFD() == fd)
-			return &_servers[i];
+		conn.input.release(); // idle connections hold no receive buffer
+		armTimer(conn, TIMER_KEEPALIVE, conn.keepAliveTimeout);
 	}
-	return NULL;
+	else
+		armReadTimer(conn);
+	debugMsg("Keeping connection alive: FD = ", conn.fd);
 }
 
-// Closes and removes client FD from ServerManager
-void ServerManager::cleanupClient(int fd)
+// (Re)starts the client's single timer; it replaces whatever the timer was waiting for
+void ServerManager::armTimer(Connection &conn, int kind, int seconds)
 {
-	close(fd);
-	FD_CLR(fd, &_master_read_fds);
-	FD_CLR(fd, &_master_write_fds);
-
-	_clientToServer.erase(fd);
-	_clientBuffers.erase(fd);
-	_clientRequests.erase(fd);
-	_clientResponses.erase(fd);
-	_responseOffsets.erase(fd);
+	conn.timer.fd = conn.fd;
+	conn.timer.kind = kind;
+	_timers->schedule(conn.timer, static_cast<unsigned long>(seconds) * 1000, monotonicMillis());
+}
 
-	debugMsg("Closed client: FD = ", fd);
+// Part of a request is buffered and the server is waiting for the rest:
+// the header must arrive within client_header_timeout of its start,
+// while client_body_timeout restarts with every read of the body
+void ServerManager::armReadTimer(Connection &conn)
+{
+	const ServerConfig &config = conn.server->getDefaultConfig();
+	if (conn.parser.inBody())
+		armTimer(conn, TIMER_BODY, config.getClientBodyTimeout());
+	else if (!_timers->isScheduled(conn.timer) || conn.timer.kind != TIMER_HEADER)
+		armTimer(conn, TIMER_HEADER, config.getClientHeaderTimeout());
+}
 
-	// Recalculate _max_fd across both read and write sets
-	if (fd == _max_fd)
+void ServerManager::expireTimers(void)
+{
+	std::vector<TimerWheel::Timer*> expired;
+	_timers->advance(monotonicMillis(), expired);
+	for (size_t i = 0; i < expired.size(); ++i)
 	{
-		_max_fd = 0;
-		for (int i = FD_SETSIZE - 1; i >= 0; --i)
-		{
-			if (FD_ISSET(i, &_master_read_fds) || FD_ISSET(i, &_master_write_fds))
-			{
-				_max_fd = i;
-				break;
-			}
-		}
+		Connection *conn = _connections->find(expired[i]->fd);
+		if (conn && &conn->timer == expired[i])
+			handleTimeout(*conn, expired[i]->kind);
 	}
 }
 
-void ServerManager::trackMaxFd(int fd)
+// A client that stalls mid-request gets a 408; silent or idle clients and
+// clients that stopped reading are simply closed
+void ServerManager::handleTimeout(Connection &conn, int kind)
 {
-	if (fd > _max_fd)
-		_max_fd = fd;
+	if ((kind == TIMER_HEADER && !conn.input.empty()) || kind == TIMER_BODY)
+	{
+		debugMsg("Request timed out: FD = ", conn.fd);
+		sendErrorResponse(conn, 408, Request());
+		handleClientWrite(conn);
+		return;
+	}
+	debugMsg(kind == TIMER_SEND ? "Send timeout: FD = " : "Idle timeout: FD = ", conn.fd);
+	cleanupClient(conn);
 }
 
+// Closes the client and returns its Connection to the pool
+void ServerManager::cleanupClient(Connection &conn)
+{
+	int fd = conn.fd;
+	_timers->cancel(conn.timer);
+	_backend->remove(fd);
+	close(fd);
+	_connections->release(&conn);
 
+	debugMsg("Closed client: FD = ", fd);
+	resumeListeners(true);
+}
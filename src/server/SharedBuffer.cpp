@@ -0,0 +1,25 @@
+#include "../../includes/SharedBuffer.hpp"
+
+SharedBuffer::SharedBuffer(void): _data(), _refs(1) {}
+
+SharedBuffer::~SharedBuffer(void) {}
+
+// Takes over the contents of data, which is left empty; the caller holds the first reference
+SharedBuffer *SharedBuffer::create(std::string &data)
+{
+	SharedBuffer *buffer = new SharedBuffer();
+	buffer->_data.swap(data);
+	return buffer;
+}
+
+const char *SharedBuffer::data(void) const { return _data.data(); }
+
+std::size_t SharedBuffer::size(void) const { return _data.size(); }
+
+void SharedBuffer::retain(void) { ++_refs; }
+
+void SharedBuffer::release(void)
+{
+	if (--_refs == 0)
+		delete this;
+}
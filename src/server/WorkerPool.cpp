@@ -0,0 +1,192 @@
+#include "../../includes/WorkerPool.hpp"
+#include <sched.h>
+
+// A worker that dies sooner than this after being spawned is respawned with a delay
+static const time_t RESPAWN_THROTTLE_SECONDS = 1;
+
+static volatile sig_atomic_t g_stopRequested = 0;
+
+WorkerPool::WorkerPool(const std::vector<ServerConfig> &configs, int workerThreads, int workerProcesses, bool cpuAffinity)
+	: _configs(configs), _workerThreads(workerThreads < 1 ? 1 : workerThreads),
+	  _workerProcesses(workerProcesses < 1 ? 1 : workerProcesses), _cpuAffinity(cpuAffinity) {}
+
+WorkerPool::~WorkerPool(void)
+{
+	for (size_t i = 0; i < _managers.size(); ++i)
+		delete _managers[i];
+}
+
+/// Binds every worker's listeners up front, so a bad address fails at startup
+/// rather than inside a thread or child process. Worker processes inherit these
+/// sockets; only several threads per process need SO_REUSEPORT copies
+void WorkerPool::setup(void)
+{
+	bool reusePort = _workerThreads > 1;
+	for (int i = 0; i < _workerThreads; ++i)
+	{
+		_managers.push_back(new ServerManager(_configs));
+		_managers.back()->setup(reusePort);
+	}
+}
+
+void WorkerPool::start(void)
+{
+	if (_workerProcesses > 1)
+		superviseProcesses();
+	else
+		runThreads();
+}
+
+/// Worker 0 runs on the calling thread; the others get a thread each
+void WorkerPool::runThreads(void)
+{
+	std::vector<pthread_t> threads;
+	for (size_t i = 1; i < _managers.size(); ++i)
+	{
+		pthread_t tid;
+		if (pthread_create(&tid, NULL, &WorkerPool::runWorker, _managers[i]) != 0)
+			fatalError("pthread_create failed");
+		threads.push_back(tid);
+	}
+	debugMsg("Worker threads started: ", static_cast<int>(_managers.size()));
+	_managers[0]->start();
+	for (size_t i = 0; i < threads.size(); ++i)
+		pthread_join(threads[i], NULL);
+}
+
+// A worker that hits a fatal error takes the process down, as the single-threaded server did
+// _exit() skips static destructors and atexit handlers, which would otherwise
+// run under the event loops still going on the other threads
+void *WorkerPool::runWorker(void *arg)
+{
+	ServerManager *manager = static_cast<ServerManager*>(arg);
+	try
+	{
+		manager->start();
+	}
+	catch (std::exception &e)
+	{
+		errorMsg(e.what());
+		_exit(1);
+	}
+	return NULL;
+}
+
+void WorkerPool::handleStopSignal(int sig)
+{
+	(void)sig;
+	g_stopRequested = 1;
+}
+
+/// Master loop: forks one process per slot, then waits for any of them to exit
+/// and forks a replacement in the same slot (keeping its CPU) until SIGINT/SIGTERM
+void WorkerPool::superviseProcesses(void)
+{
+	struct sigaction sa;
+	std::memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = &WorkerPool::handleStopSignal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	_workerPids.assign(_workerProcesses, -1);
+	_spawnTimes.assign(_workerProcesses, 0);
+	for (int slot = 0; slot < _workerProcesses; ++slot)
+		spawnProcess(slot);
+	debugMsg("Worker processes started: ", _workerProcesses);
+
+	while (!g_stopRequested)
+	{
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			fatalError("waitpid failed");
+		}
+		int slot = findSlot(pid);
+		if (slot < 0 || g_stopRequested)
+			continue;
+		if (WIFSIGNALED(status))
+			errorMsg("Worker process died from signal " + toString(WTERMSIG(status)) + ", respawning slot " + toString(slot));
+		else
+			errorMsg("Worker process exited with status " + toString(WEXITSTATUS(status)) + ", respawning slot " + toString(slot));
+		_workerPids[slot] = -1;
+		if (time(NULL) - _spawnTimes[slot] < RESPAWN_THROTTLE_SECONDS)
+			sleep(RESPAWN_THROTTLE_SECONDS);
+		if (!g_stopRequested)
+			spawnProcess(slot);
+	}
+	stopProcesses();
+}
+
+// The child never returns into main(): it runs its event loops until it dies
+pid_t WorkerPool::spawnProcess(int slot)
+{
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		errorMsg("fork failed for worker slot " + toString(slot));
+		return -1;
+	}
+	if (pid == 0)
+	{
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		if (_cpuAffinity)
+			pinToCpu(slot);
+		try
+		{
+			runThreads();
+		}
+		catch (std::exception &e)
+		{
+			errorMsg(e.what());
+		}
+		_exit(1);
+	}
+	_workerPids[slot] = pid;
+	_spawnTimes[slot] = time(NULL);
+	return pid;
+}
+
+void WorkerPool::pinToCpu(int slot) const
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(slot % onlineCpuCount(), &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		errorMsg("sched_setaffinity failed for worker slot " + toString(slot));
+#else
+	(void)slot;
+	errorMsg("worker_cpu_affinity is not supported on this system");
+#endif
+}
+
+void WorkerPool::stopProcesses(void)
+{
+	debugMsg("Stopping worker processes");
+	for (size_t i = 0; i < _workerPids.size(); ++i)
+	{
+		if (_workerPids[i] > 0)
+			kill(_workerPids[i], SIGTERM);
+	}
+	for (size_t i = 0; i < _workerPids.size(); ++i)
+	{
+		if (_workerPids[i] > 0)
+			waitpid(_workerPids[i], NULL, 0);
+		_workerPids[i] = -1;
+	}
+}
+
+int WorkerPool::findSlot(pid_t pid) const
+{
+	for (size_t i = 0; i < _workerPids.size(); ++i)
+	{
+		if (_workerPids[i] == pid)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
@@ -1,4 +1,5 @@
 #include "../../includes/common.hpp"
+#include <ctime>
 
 std::string trimR(const std::string &line)
 {
@@ -53,9 +54,11 @@ std::string httpStatusMessage(int code) {
 		case 200: return "OK";
 		case 201: return "Created";
 		case 204: return "No Content";
+		case 206: return "Partial Content";
 		case 301: return "Moved Permanently";
 		case 302: return "Found";
 		case 303: return "See Other";
+		case 304: return "Not Modified";
 		case 307: return "Temporary Redirect";
 		case 308: return "Permanent Redirect";
 		case 400: return "Bad Request";
@@ -63,12 +66,16 @@ std::string httpStatusMessage(int code) {
 		case 403: return "Forbidden";
 		case 404: return "Not Found";
 		case 405: return "Method Not Allowed";
+		case 408: return "Request Timeout";
 		case 409: return "Conflict";
 		case 411: return "Length Required";
 		case 413: return "Payload Too Large";
 		case 414: return "URI Too Long";
 		case 415: return "Unsupported Media Type";
+		case 416: return "Range Not Satisfiable";
+		case 417: return "Expectation Failed";
 		case 426: return "Upgrade Required";
+		case 431: return "Request Header Fields Too Large";
 		case 500: return "Internal Server Error";
 		case 501: return "Not Implemented";
 		case 502: return "Bad Gateway";
@@ -77,6 +84,41 @@ std::string httpStatusMessage(int code) {
 	}
 }
 
+int onlineCpuCount(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? static_cast<int>(n) : 1;
+}
+
+// Milliseconds from an arbitrary fixed point; unaffected by wall-clock changes
+unsigned long monotonicMillis(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<unsigned long>(ts.tv_sec) * 1000UL + static_cast<unsigned long>(ts.tv_nsec) / 1000000UL;
+}
+
+// Descriptors are created close-on-exec in the same syscall: with worker threads,
+// another thread may fork a CGI at any moment, and a descriptor it inherits
+// (e.g. the write end of a CGI's stdin) can keep another child waiting forever
+int dupCloexec(int fd)
+{
+	return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+}
+
+int pipeCloexec(int fds[2])
+{
+#ifdef __linux__
+	return pipe2(fds, O_CLOEXEC);
+#else
+	if (pipe(fds) == -1)
+		return -1;
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	return 0;
+#endif
+}
+
 std::string joinPath(const std::string &base, const std::string &relative) {
 	if (base.empty())
 		return relative;
@@ -89,3 +131,86 @@ std::string joinPath(const std::string &base, const std::string &relative) {
 		return base + "/" + relative; // add missing slash
 	return base + relative; // just concatenate
 }
+
+// To avoid filenames like ../../../etc/passwd that will escape intended upload directory
+// keeps alphanumerics, dots, underscores and hyphens; replace all others with _
+std::string sanitizeFilename(const std::string& filename)
+{
+	std::string clean;
+	for (size_t i = 0; i < filename.size(); ++i)
+	{
+		char c = filename[i];
+		if (std::isalnum(c) || c == '.' || c == '_' || c == '-')
+			clean += c;
+		else
+			clean += '_';
+	}
+	if (clean.empty())
+		clean = "upload";
+	return clean;
+}
+
+// The directory part of path resolves to baseDir or somewhere below it
+bool isSafePath(const std::string &path, const std::string &baseDir)
+{
+	char *resolvedBase = realpath(baseDir.c_str(), NULL);
+	if (!resolvedBase)
+		return false;
+
+	// Get directory part of the path
+	std::string dirPart = path.substr(0, path.find_last_of("/"));
+	char *resolvedDir = realpath(dirPart.c_str(), NULL);
+
+	if (!resolvedDir)
+	{
+		free(resolvedBase);
+		return false;
+	}
+
+	std::string baseStr(resolvedBase);
+	std::string dirStr(resolvedDir);
+
+	free(resolvedBase);
+	free(resolvedDir);
+
+	if (dirStr == baseStr)
+		return true;
+	if (dirStr.compare(0, baseStr.length(), baseStr) == 0 &&
+		(dirStr[baseStr.length()] == '/' || dirStr.length() == baseStr.length()))
+		return true;
+
+	return false;
+}
+
+// t as an HTTP-date (IMF-fixdate), e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string httpDate(time_t t)
+{
+	struct tm tm;
+	char buf[64];
+	gmtime_r(&t, &tm);
+	std::size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	return std::string(buf, n);
+}
+
+// Reads an HTTP-date in any of the three formats HTTP/1.1 recipients must accept:
+// IMF-fixdate, the obsolete RFC 850 one and asctime()'s
+bool parseHttpDate(const std::string &value, time_t &t)
+{
+	static const char *formats[] = {
+		"%a, %d %b %Y %H:%M:%S GMT",
+		"%A, %d-%b-%y %H:%M:%S GMT",
+		"%a %b %e %H:%M:%S %Y"
+	};
+	for (std::size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+	{
+		struct tm tm;
+		std::memset(&tm, 0, sizeof(tm));
+		const char *end = strptime(value.c_str(), formats[i], &tm);
+		if (end && *end == '\0')
+		{
+			t = timegm(&tm);
+			return t != static_cast<time_t>(-1);
+		}
+	}
+	return false;
+}